@@ -0,0 +1,290 @@
+# SPDX-FileCopyrightText: 2026 The meson-python developers
+#
+# SPDX-License-Identifier: MIT
+
+"""Measure the performance of the build backend on the test packages.
+
+Each benchmark runs the PEP 517 hooks in a separate interpreter, as a
+build frontend would, from a copy of the package turned into a git
+repository. The results are written as JSON.
+"""
+
+from __future__ import annotations
+
+import argparse
+import ast
+import json
+import os
+import pathlib
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import textwrap
+import time
+import zipfile
+
+from typing import Any, Callable, Dict, List, Optional
+
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+PACKAGES = ROOT / 'tests' / 'packages'
+
+FIXTURES = [
+    'complex',
+    'install-subdir',
+    'library',
+    'limited-api',
+    'link-against-local-lib',
+    'pure',
+    'purelib-and-platlib',
+    'scipy-like',
+]
+
+PYPROJECT = textwrap.dedent('''
+    [build-system]
+    build-backend = 'mesonpy'
+    requires = ['meson-python']
+''')
+
+
+def _write(path: pathlib.Path, text: str) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(text, encoding='utf-8')
+
+
+def synthetic_modules(path: pathlib.Path, scale: int) -> None:
+    """A pure package with many modules, in nested subpackages."""
+    sources = []
+    for i in range(scale):
+        name = f'many_modules/sub{i // 100}/mod{i}.py'
+        _write(path / name, f'VALUE = {i}\n')
+        sources.append(name)
+    for i in range((scale + 99) // 100):
+        name = f'many_modules/sub{i}/__init__.py'
+        _write(path / name, '')
+        sources.append(name)
+    _write(path / 'many_modules' / '__init__.py', '')
+    sources.append('many_modules/__init__.py')
+    _write(path / 'meson.build', "project('synthetic-modules', version: '1.0.0')\n"
+           "py = import('python').find_installation()\n"
+           "py.install_sources(\n" + ''.join(f'  {x!r},\n' for x in sorted(sources)) +
+           "  preserve_path: true,\n)\n")
+    _write(path / 'pyproject.toml', PYPROJECT)
+
+
+def synthetic_data(path: pathlib.Path, scale: int) -> None:
+    """A package installing a large directory of data files."""
+    _write(path / 'large_data' / '__init__.py', '')
+    for i in range(scale):
+        data = os.urandom(4096) + bytes(range(256)) * 48
+        file = path / 'large_data' / 'data' / f'dir{i // 100}' / f'file{i}.bin'
+        file.parent.mkdir(parents=True, exist_ok=True)
+        file.write_bytes(data)
+    _write(path / 'meson.build', textwrap.dedent('''
+        project('synthetic-data', version: '1.0.0')
+        py = import('python').find_installation()
+        install_subdir('large_data', install_dir: py.get_install_dir())
+    '''))
+    _write(path / 'pyproject.toml', PYPROJECT)
+
+
+def synthetic_libs(path: pathlib.Path, scale: int) -> None:
+    """A package with many extension modules linked to internal shared libraries."""
+    count = max(2, scale // 50)
+    lines = [
+        "project('synthetic-libs', 'c', version: '1.0.0')",
+        "py = import('python').find_installation()",
+        "py.install_sources('many_libs/__init__.py', subdir: 'many_libs')",
+    ]
+    _write(path / 'many_libs' / '__init__.py', '')
+    for i in range(count):
+        _write(path / f'lib{i}.c', f'int value{i}(void) {{ return {i}; }}\n')
+        _write(path / f'ext{i}.c', textwrap.dedent(f'''
+            #include <Python.h>
+            int value{i}(void);
+            static PyObject* value(PyObject* self, PyObject* args) {{ return PyLong_FromLong(value{i}()); }}
+            static PyMethodDef methods[] = {{{{"value", value, METH_NOARGS, NULL}}, {{NULL, NULL, 0, NULL}}}};
+            static struct PyModuleDef module = {{PyModuleDef_HEAD_INIT, "ext{i}", NULL, -1, methods}};
+            PyMODINIT_FUNC PyInit_ext{i}(void) {{ return PyModule_Create(&module); }}
+        '''))
+        lines.append(f"lib{i} = shared_library('lib{i}', 'lib{i}.c', install: true)")
+        lines.append(f"py.extension_module('ext{i}', 'ext{i}.c', link_with: lib{i}, install: true, subdir: 'many_libs')")
+    _write(path / 'meson.build', '\n'.join(lines) + '\n')
+    _write(path / 'pyproject.toml', PYPROJECT)
+
+
+SYNTHETIC: Dict[str, Callable[[pathlib.Path, int], None]] = {
+    'synthetic-modules': synthetic_modules,
+    'synthetic-data': synthetic_data,
+    'synthetic-libs': synthetic_libs,
+}
+
+
+def prepare(name: str, workdir: pathlib.Path, scale: int) -> pathlib.Path:
+    """Copy or generate a package, in a git repository as 'meson dist' requires."""
+    path = workdir / name / 'source'
+    if name in SYNTHETIC:
+        path.mkdir(parents=True)
+        SYNTHETIC[name](path, scale)
+    else:
+        shutil.copytree(PACKAGES / name, path)
+    git = ['git', '-c', 'user.name=benchmark', '-c', 'user.email=benchmark@example.com']
+    subprocess.run([*git, 'init', '-q'], cwd=path, check=True)
+    subprocess.run([*git, 'add', '-A'], cwd=path, check=True)
+    subprocess.run([*git, 'commit', '-q', '-m', 'benchmark'], cwd=path, check=True)
+    return path
+
+
+def hook(source: pathlib.Path, name: str, directory: pathlib.Path, settings: Dict[str, str]) -> str:
+    """Run a PEP 517 hook in a new interpreter and return the artifact name."""
+    directory.mkdir(parents=True, exist_ok=True)
+    code = f'import mesonpy; print(mesonpy.{name}({os.fspath(directory)!r}, {settings!r}))'
+    r = subprocess.run([sys.executable, '-c', code], cwd=source, capture_output=True, text=True)
+    if r.returncode != 0:
+        raise RuntimeError(f'{name} failed:\n{r.stdout}{r.stderr}')
+    return r.stdout.strip().splitlines()[-1]
+
+
+def timed(func: Callable[[], Any]) -> float:
+    start = time.perf_counter()
+    func()
+    return time.perf_counter() - start
+
+
+def editable_import(wheel: pathlib.Path, site: pathlib.Path) -> float:
+    """Install an editable wheel in a directory and time the first import in a new interpreter."""
+    if site.exists():
+        shutil.rmtree(site)
+    with zipfile.ZipFile(wheel) as z:
+        z.extractall(site)
+    loader = next(site.glob('_*_editable_loader.py')).read_text(encoding='utf-8')
+    call = ast.parse(loader).body[-1]
+    assert isinstance(call, ast.Expr) and isinstance(call.value, ast.Call)
+    names = sorted(ast.literal_eval(call.value.args[1]))
+    code = textwrap.dedent(f'''
+        import site, time
+        site.addsitedir({os.fspath(site)!r})
+        start = time.perf_counter()
+        for name in {names!r}:
+            __import__(name)
+        print(time.perf_counter() - start)
+    ''')
+    r = subprocess.run([sys.executable, '-c', code], capture_output=True, text=True)
+    if r.returncode != 0:
+        raise RuntimeError(f'import failed:\n{r.stdout}{r.stderr}')
+    return float(r.stdout.strip().splitlines()[-1])
+
+
+def run(name: str, workdir: pathlib.Path, scale: int, repeat: int) -> Dict[str, Any]:
+    source = prepare(name, workdir, scale)
+    out = workdir / name / 'dist'
+    samples: Dict[str, List[float]] = {}
+    errors: Dict[str, str] = {}
+
+    def measure(benchmark: str, func: Callable[[], float]) -> None:
+        for _ in range(repeat):
+            try:
+                samples.setdefault(benchmark, []).append(func())
+            except Exception as e:
+                errors[benchmark] = str(e)
+                samples.pop(benchmark, None)
+                return
+
+    def wheel_cold() -> float:
+        build = workdir / name / 'build-wheel'
+        shutil.rmtree(build, ignore_errors=True)
+        return timed(lambda: hook(source, 'build_wheel', out, {'build-dir': os.fspath(build)}))
+
+    def wheel_warm() -> float:
+        build = workdir / name / 'build-wheel'
+        return timed(lambda: hook(source, 'build_wheel', out, {'build-dir': os.fspath(build)}))
+
+    def wheel_packing() -> float:
+        # Time only the mapping of the files to the wheel and the packing,
+        # without reusing the members of the previous wheel.
+        build = workdir / name / 'build-wheel'
+        index = build / 'meson-python-wheel-index.json'
+        if index.exists():
+            index.unlink()
+        hook(source, 'build_wheel', out, {'build-dir': os.fspath(build), 'timing-report': 'json'})
+        totals = json.loads(build.joinpath('meson-python-timings.json').read_text(encoding='utf-8'))['totals']
+        return sum(totals[phase]['duration'] for phase in ('manifest', 'wheel'))
+
+    def sdist() -> float:
+        return timed(lambda: hook(source, 'build_sdist', out, {}))
+
+    editable: Dict[str, pathlib.Path] = {}
+
+    def editable_cold() -> float:
+        build = workdir / name / 'build-editable'
+        shutil.rmtree(build, ignore_errors=True)
+        start = time.perf_counter()
+        editable['wheel'] = out / hook(source, 'build_editable', out, {'build-dir': os.fspath(build)})
+        return time.perf_counter() - start
+
+    def first_import() -> float:
+        return editable_import(editable['wheel'], workdir / name / 'site')
+
+    measure('build_wheel cold', wheel_cold)
+    measure('build_wheel warm', wheel_warm)
+    measure('wheel packing', wheel_packing)
+    measure('build_sdist', sdist)
+    measure('build_editable cold', editable_cold)
+    if 'wheel' in editable:
+        measure('editable first import', first_import)
+
+    results: Dict[str, Any] = {}
+    for benchmark, values in samples.items():
+        results[benchmark] = {
+            'samples': values,
+            'min': min(values),
+            'median': statistics.median(values),
+        }
+    return {'results': results, 'errors': errors}
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('fixtures', nargs='*', help='packages to benchmark, all by default')
+    parser.add_argument('--output', default='benchmark-results.json', help='results file')
+    parser.add_argument('--repeat', type=int, default=3, help='number of runs of each benchmark')
+    parser.add_argument('--scale', type=int, default=1000, help='size of the synthetic packages')
+    args = parser.parse_args(argv)
+
+    fixtures = args.fixtures or [*FIXTURES, *SYNTHETIC]
+    unknown = [x for x in fixtures if x not in SYNTHETIC and not (PACKAGES / x).is_dir()]
+    if unknown:
+        parser.error(f'unknown packages: {", ".join(unknown)}')
+
+    import mesonpy
+
+    report: Dict[str, Any] = {
+        'python': sys.version,
+        'platform': platform.platform(),
+        'meson-python': mesonpy.__version__,
+        'scale': args.scale,
+        'repeat': args.repeat,
+        'fixtures': {},
+    }
+    failed = False
+    with tempfile.TemporaryDirectory(prefix='mesonpy-benchmark-') as tmp:
+        for name in fixtures:
+            print(f'{name} ...', flush=True)
+            report['fixtures'][name] = data = run(name, pathlib.Path(tmp), args.scale, args.repeat)
+            for benchmark, result in data['results'].items():
+                print(f'  {benchmark:<24} {result["median"]:8.3f} s', flush=True)
+            for benchmark, error in data['errors'].items():
+                print(f'  {benchmark:<24} failed: {error.splitlines()[0]}', flush=True)
+                failed = True
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        json.dump(report, f, indent=2)
+    # the results of the other benchmarks are written anyway
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -13,17 +13,21 @@ from __future__ import annotations
 
 import argparse
 import collections
+import concurrent.futures
 import contextlib
 import difflib
 import functools
+import hashlib
 import importlib.machinery
 import io
-import itertools
 import json
+import math
 import os
 import pathlib
 import platform
+import posixpath
 import re
+import shlex
 import shutil
 import subprocess
 import sys
@@ -31,8 +35,10 @@ import sysconfig
 import tarfile
 import tempfile
 import textwrap
+import time
 import typing
 import warnings
+import zipfile
 
 
 if sys.version_info < (3, 11):
@@ -45,6 +51,8 @@ import packaging.version
 import pyproject_metadata
 
 import mesonpy._compat
+import mesonpy._debug
+import mesonpy._editable
 import mesonpy._rpath
 import mesonpy._tags
 import mesonpy._util
@@ -54,7 +62,10 @@ from mesonpy._compat import cached_property, read_binary
 
 
 if typing.TYPE_CHECKING:  # pragma: no cover
-    from typing import Any, Callable, DefaultDict, Dict, List, Literal, Optional, Sequence, TextIO, Tuple, Type, TypeVar, Union
+    from typing import (
+        IO, Any, Callable, ContextManager, DefaultDict, Dict, List, Literal, Optional, Sequence, TextIO, Tuple, Type,
+        TypeVar, Union
+    )
 
     from mesonpy._compat import Collection, Iterator, Mapping, ParamSpec, Path, Self
 
@@ -64,6 +75,11 @@ if typing.TYPE_CHECKING:  # pragma: no cover
     MesonArgsKeys = Literal['dist', 'setup', 'compile', 'install']
     MesonArgs = Mapping[MesonArgsKeys, List[str]]
 
+    # The files to be added to the wheel, organized by wheel path: the
+    # path relative to the wheel path, the source path, and the status
+    # of the source file, if it exists.
+    Manifest = DefaultDict[str, List[Tuple[str, str, Optional[os.stat_result]]]]
+
 
 __version__ = '0.17.0.dev0'
 
@@ -92,16 +108,36 @@ _INSTALLATION_PATH_MAP = {
 }
 
 
-def _map_to_wheel(sources: Dict[str, Dict[str, Any]]) -> DefaultDict[str, List[Tuple[pathlib.Path, str]]]:
-    """Map files to the wheel, organized by wheel installation directory."""
-    wheel_files: DefaultDict[str, List[Tuple[pathlib.Path, str]]] = collections.defaultdict(list)
+_BUILD_PROFILES = ('release', 'release-lto', 'dev-fast')
+
+
+# Environment variables read by Meson when setting up a project.
+_SETUP_ENVIRONMENT = (
+    'AR', 'CC', 'CXX', 'OBJC', 'OBJCXX', 'FC', 'RUSTC', 'CYTHON', 'NINJA', 'PKG_CONFIG',
+    'CFLAGS', 'CXXFLAGS', 'CPPFLAGS', 'OBJCFLAGS', 'OBJCXXFLAGS', 'FFLAGS', 'LDFLAGS', 'RUSTFLAGS',
+    'CC_LD', 'CXX_LD', 'PKG_CONFIG_PATH', 'PKG_CONFIG_LIBDIR', 'PKG_CONFIG_SYSROOT_DIR', 'CMAKE_PREFIX_PATH',
+    '_PYTHON_HOST_PLATFORM', 'MACOSX_DEPLOYMENT_TARGET',
+)
+
+# Environment variables set by meson-python that Meson reads only when
+# detecting the compilers, on the first setup of a build directory.
+_COMPILERS_ENVIRONMENT = ('CC', 'CXX', 'OBJC', 'OBJCXX', 'CFLAGS', 'CXXFLAGS', 'CC_LD', 'CXX_LD')
+
+
+def _map_to_wheel(sources: Dict[str, Dict[str, Any]]) -> Manifest:
+    """Map files to the wheel, organized by wheel installation directory.
+
+    The files are mapped to their POSIX path relative to the wheel
+    installation directory, the source path, and the source file status.
+    """
+    wheel_files: Manifest = collections.defaultdict(list)
     packages: Dict[str, str] = {}
 
     for key, group in sources.items():
         for src, target in group.items():
             destination = pathlib.Path(target['destination'])
             anchor = destination.parts[0]
-            dst = pathlib.Path(*destination.parts[1:])
+            dst = '/'.join(destination.parts[1:])
 
             path = _INSTALLATION_PATH_MAP.get(anchor)
             if path is None:
@@ -112,7 +148,8 @@ def _map_to_wheel(sources: Dict[str, Dict[str, Any]]) -> DefaultDict[str, List[T
                 other = packages.setdefault(package, path)
                 if other != path:
                     this = os.fspath(pathlib.Path(path, *destination.parts[1:]))
-                    that = os.fspath(other / next(d for d, s in wheel_files[other] if d.parts[0] == destination.parts[1]))
+                    that = next(d for d, _, _ in wheel_files[other] if d.split('/', 1)[0] == package)
+                    that = os.fspath(pathlib.Path(other, that))
                     raise BuildError(
                         f'The {package} package is split between {path} and {other}: '
                         f'{this!r} and {that!r}, a "pure: false" argument may be missing in meson.build. '
@@ -122,23 +159,22 @@ def _map_to_wheel(sources: Dict[str, Dict[str, Any]]) -> DefaultDict[str, List[T
                 assert os.path.isdir(src)
                 exclude_files = {os.path.normpath(x) for x in target.get('exclude_files', [])}
                 exclude_dirs = {os.path.normpath(x) for x in target.get('exclude_dirs', [])}
-                for root, dirnames, filenames in os.walk(src):
-                    for name in dirnames.copy():
-                        dirsrc = os.path.join(root, name)
-                        relpath = os.path.relpath(dirsrc, src)
-                        if relpath in exclude_dirs:
-                            dirnames.remove(name)
-                    # sort to process directories determninistically
-                    dirnames.sort()
-                    for name in sorted(filenames):
-                        filesrc = os.path.join(root, name)
-                        relpath = os.path.relpath(filesrc, src)
-                        if relpath in exclude_files:
-                            continue
-                        filedst = dst / relpath
-                        wheel_files[path].append((filedst, filesrc))
+                # The directory entries cache the file status, reused
+                # when the files are added to the wheel.
+                for relpath, entry in mesonpy._editable.walk(src, exclude_files, exclude_dirs):
+                    if os.sep != '/':
+                        relpath = relpath.replace(os.sep, '/')
+                    try:
+                        st: Optional[os.stat_result] = entry.stat()
+                    except OSError:
+                        st = None
+                    wheel_files[path].append((f'{dst}/{relpath}' if dst else relpath, entry.path, st))
             else:
-                wheel_files[path].append((dst, src))
+                try:
+                    st = os.stat(src)
+                except OSError:
+                    st = None
+                wheel_files[path].append((dst, src, st))
 
     return wheel_files
 
@@ -195,22 +231,33 @@ def _showwarning(
 
 
 class _clicounter:
+    # Minimum interval between progress updates, in seconds. The last
+    # update is always shown.
+    INTERVAL = 0.1
+
     def __init__(self, total: int) -> None:
         self._total = total
-        self._count = itertools.count(start=1)
+        self._count = 0
+        self._last = -math.inf
+        self._ansi = _use_ansi_escapes()
 
     def __enter__(self) -> Self:
         return self
 
     def update(self, description: str) -> None:
-        line = f'[{next(self._count)}/{self._total}] {description}'
-        if _use_ansi_escapes():
+        self._count += 1
+        now = time.monotonic()
+        if now - self._last < self.INTERVAL and self._count != self._total:
+            return
+        self._last = now
+        line = f'[{self._count}/{self._total}] {description}'
+        if self._ansi:
             print('\r', line, sep='', end='\33[0K', flush=True)
         else:
             print(line)
 
     def __exit__(self, exc_type: Any, exc_value: Any, exc_tb: Any) -> None:
-        if _use_ansi_escapes():
+        if self._ansi:
             print()
 
 
@@ -285,22 +332,49 @@ class Metadata(pyproject_metadata.StandardMetadata):
         return self.canonical_name.replace('-', '_')
 
 
+def _is_native_header(header: bytes) -> bool:
+    """Check if the first bytes of a file identify a native file."""
+    if sys.platform == 'darwin':
+        return header[:4] in (
+            b'\xfe\xed\xfa\xce',  # 32-bit
+            b'\xfe\xed\xfa\xcf',  # 64-bit
+            b'\xcf\xfa\xed\xfe',  # arm64
+            b'\xca\xfe\xba\xbe',  # universal / fat (same as java class so beware!)
+        )
+    elif sys.platform == 'win32' or sys.platform == 'cygwin':
+        return header[:2] == b'MZ'
+    else:
+        # Assume that any other platform uses ELF binaries.
+        return header[:4] == b'\x7fELF'  # ELF
+
+
 def _is_native(file: Path) -> bool:
     """Check if file is a native file."""
 
     with open(file, 'rb') as f:
-        if sys.platform == 'darwin':
-            return f.read(4) in (
-                b'\xfe\xed\xfa\xce',  # 32-bit
-                b'\xfe\xed\xfa\xcf',  # 64-bit
-                b'\xcf\xfa\xed\xfe',  # arm64
-                b'\xca\xfe\xba\xbe',  # universal / fat (same as java class so beware!)
-            )
-        elif sys.platform == 'win32' or sys.platform == 'cygwin':
-            return f.read(2) == b'MZ'
-        else:
-            # Assume that any other platform uses ELF binaries.
-            return f.read(4) == b'\x7fELF'  # ELF
+        return _is_native_header(f.read(4))
+
+
+# Meson target types and whether the files they build are native files.
+# Files built by other targets, or not built at all, are classified
+# inspecting their content.
+_NATIVE_TARGET_TYPES = {
+    'executable': True,
+    'shared library': True,
+    'shared module': True,
+    'static library': False,
+    'jar': False,
+}
+
+# Compression methods that can be selected for the wheel members by
+# file name suffix, see the wheel-compression-methods setting.
+_WHEEL_COMPRESSION_METHODS = {'stored': zipfile.ZIP_STORED, 'deflated': zipfile.ZIP_DEFLATED}
+
+# Files with the same content installed in several locations are
+# compressed only once: the compressed data of the first copy is copied
+# from the archive for the others. Smaller files, like the many Python
+# modules containing only a license header, are not worth hashing.
+_DUPLICATE_MIN_SIZE = 64 * 1024
 
 
 class _WheelBuilder():
@@ -309,12 +383,39 @@ class _WheelBuilder():
     def __init__(
         self,
         metadata: Metadata,
-        manifest: Dict[str, List[Tuple[pathlib.Path, str]]],
+        manifest: Manifest,
         limited_api: bool,
+        jobs: int = 1,
+        compression_level: Optional[int] = None,
+        native_files: Optional[Dict[str, bool]] = None,
+        index_file: Optional[pathlib.Path] = None,
+        timings: Optional[mesonpy._util.Timings] = None,
+        debug_symbols: Optional[pathlib.Path] = None,
+        compression_methods: Optional[Dict[str, int]] = None,
     ) -> None:
         self._metadata = metadata
         self._manifest = manifest
         self._limited_api = limited_api
+        self._jobs = jobs
+        self._compression_level = compression_level
+        self._compression_methods = compression_methods
+        # Whether files are native, indexed by normalized path. Entries
+        # not known in advance are added as the files are inspected.
+        self._native_files = dict(native_files or {})
+        self._index_file = index_file
+        self._timings = timings
+        # When the debug information is stripped from the native files,
+        # the directory where the debug symbols archive is written, the
+        # staging directory, and the files to add to the archive.
+        self._debug_symbols = debug_symbols
+        self._debug_dir: Optional[pathlib.Path] = None
+        self._debug_files: List[Tuple[pathlib.Path, str]] = []
+
+    def _phase(self, name: str, **args: Any) -> ContextManager[Dict[str, Any]]:
+        """Time a phase of the wheel build, when timings are recorded."""
+        if self._timings is None:
+            return contextlib.nullcontext(args)
+        return self._timings.phase(name, **args)
 
     @property
     def _has_internal_libs(self) -> bool:
@@ -330,8 +431,8 @@ class _WheelBuilder():
         """Whether the wheel is architecture independent"""
         if self._manifest['platlib'] or self._manifest['mesonpy-libs']:
             return False
-        for _, file in self._manifest['scripts']:
-            if _is_native(file):
+        for _, file, _ in self._manifest['scripts']:
+            if self._is_native(file):
                 return False
         return True
 
@@ -414,37 +515,204 @@ class _WheelBuilder():
                 # in {platlib} that look like extension modules, and raise
                 # an exception if any of them has a Python version
                 # specific extension filename suffix ABI tag.
-                for path, _ in self._manifest['platlib']:
-                    match = _EXTENSION_SUFFIX_REGEX.match(path.name)
+                for path, _, _ in self._manifest['platlib']:
+                    match = _EXTENSION_SUFFIX_REGEX.match(path.rsplit('/', 1)[-1])
                     if match:
                         abi = match.group('abi')
                         if abi is not None and abi != 'abi3':
                             raise BuildError(
                                 f'The package declares compatibility with Python limited API but extension '
-                                f'module {os.fspath(path)!r} is tagged for a specific Python version.')
+                                f'module {os.path.normpath(path)!r} is tagged for a specific Python version.')
             return 'abi3'
         return None
 
-    def _install_path(self, wheel_file: mesonpy._wheelfile.WheelFile, origin: Path, destination: pathlib.Path) -> None:
-        """Add a file to the wheel."""
-
-        if self._has_internal_libs:
-            if _is_native(origin):
+    def _is_native(self, file: Path, fileobj: Optional[IO[bytes]] = None) -> bool:
+        """Check if file is a native file.
+
+        The classification derived from the Meson target types is used
+        when available, otherwise the file content is inspected, reading
+        from the already open file object, if given.
+        """
+        key = os.path.normpath(file)
+        native = self._native_files.get(key)
+        if native is None:
+            if fileobj is None:
+                native = _is_native(file)
+            else:
+                native = _is_native_header(fileobj.read(4))
+                fileobj.seek(0)
+            self._native_files[key] = native
+        return native
+
+    @contextlib.contextmanager
+    def _open(
+        self, origin: Path, arcname: str, tmpdir: pathlib.Path
+    ) -> Iterator[Tuple[mesonpy._wheelfile.Readable, os.stat_result]]:
+        """Open a file to be added to the wheel, relocating it if needed.
+
+        The file is opened only once: the same file object is used to
+        classify the file, to compute the RPATH modifications, and to
+        read the content to be added to the wheel.
+        """
+        with open(origin, 'rb') as f:
+            st = os.fstat(f.fileno())
+            if self._debug_dir is not None and sys.platform not in {'win32', 'cygwin'} and self._is_native(origin, f):
+                # Strip the debug information from a copy of the file,
+                # relocating it first, if needed.
+                copy = tmpdir.joinpath(arcname)
+                copy.parent.mkdir(parents=True, exist_ok=True)
+                shutil.copy2(origin, copy)
+                if self._has_internal_libs:
+                    with self._phase('rpath', path=arcname):
+                        mesonpy._rpath.fix_rpath(copy, os.path.relpath(self._libs_dir, posixpath.dirname(arcname) or '.'))
+                with self._phase('strip', path=arcname):
+                    try:
+                        self._debug_files.extend(mesonpy._debug.split_debug(copy, arcname, self._debug_dir))
+                    except (OSError, subprocess.CalledProcessError) as exc:
+                        raise BuildError(f'Could not strip the debug information from {arcname!r}: {exc}')
+                with open(copy, 'rb') as c:
+                    yield c, os.fstat(c.fileno())
+                return
+            if self._has_internal_libs and self._is_native(origin, f):
                 # When an executable, libray, or Python extension module is
                 # dynamically linked to a library built as part of the project,
                 # Meson adds a library load path to it pointing to the build
                 # directory, in the form of a relative RPATH entry. meson-python
                 # relocates the shared libraries to the $project.mesonpy.libs
                 # folder. Rewrite the RPATH to point to that folder instead.
-                libspath = os.path.relpath(self._libs_dir, destination.parent)
-                mesonpy._rpath.fix_rpath(origin, libspath)
+                # The files in the build directory are not modified, to avoid
+                # triggering a relink on the next incremental build: the new
+                # RPATH is patched in while the file is added to the wheel or,
+                # when that is not possible, a copy of the file is modified.
+                libspath = os.path.relpath(self._libs_dir, posixpath.dirname(arcname) or '.')
+                with self._phase('rpath', path=arcname):
+                    patches = mesonpy._rpath.rpath_patches(f, libspath)
+                    if patches is None:
+                        copy = tmpdir.joinpath(arcname)
+                        copy.parent.mkdir(parents=True, exist_ok=True)
+                        shutil.copy2(origin, copy)
+                        mesonpy._rpath.fix_rpath(copy, libspath)
+                if patches is None:
+                    with open(copy, 'rb') as c:
+                        yield c, os.fstat(c.fileno())
+                    return
+                if patches:
+                    yield mesonpy._wheelfile.PatchedFile(f, patches), st
+                    return
+            yield f, st
+
+    def _reuse(
+        self, wheel_file: mesonpy._wheelfile.WheelFile, index: Optional[mesonpy._wheelfile.WheelIndex],
+        origin: Path, arcname: str, st: Optional[os.stat_result]
+    ) -> Optional[mesonpy._wheelfile.CompressedMember]:
+        """Return the member of the previous wheel to reuse for a file, if any."""
+        if index is None or st is None:
+            return None
+        if self._debug_symbols is not None and self._is_native(origin):
+            # The debug information needs to be extracted again.
+            return None
+        return index.lookup(wheel_file.fileinfo(arcname, st), origin, st)
+
+    def _install_path(
+        self, wheel_file: mesonpy._wheelfile.WheelFile, index: Optional[mesonpy._wheelfile.WheelIndex],
+        origin: Path, arcname: str, st: Optional[os.stat_result], tmpdir: pathlib.Path
+    ) -> None:
+        """Add a file to the wheel."""
+        try:
+            with self._phase('file', path=arcname) as stats:
+                member = self._reuse(wheel_file, index, origin, arcname, st)
+                stats['reused'] = member is not None
+                if member is not None:
+                    wheel_file.writecompressed(member)
+                    return
+                with self._open(origin, arcname, tmpdir) as (f, fst):
+                    stats['size'] = fst.st_size
+                    wheel_file.writefile(wheel_file.fileinfo(arcname, fst), f, fst.st_size)
+        except FileNotFoundError:
+            # work around for Meson bug, see https://github.com/mesonbuild/meson/pull/11655
+            if not os.fspath(origin).endswith('.pdb'):
+                raise
 
+    def _compress_path(
+        self, wheel_file: mesonpy._wheelfile.WheelFile, index: Optional[mesonpy._wheelfile.WheelIndex],
+        origin: Path, arcname: str, st: Optional[os.stat_result], tmpdir: pathlib.Path
+    ) -> Optional[mesonpy._wheelfile.CompressedMember]:
+        """Prepare a file to be added to the wheel. Safe to call from worker threads."""
         try:
-            wheel_file.write(origin, destination.as_posix())
+            with self._phase('file', path=arcname) as stats:
+                member = self._reuse(wheel_file, index, origin, arcname, st)
+                stats['reused'] = member is not None
+                if member is not None:
+                    return member
+                with self._open(origin, arcname, tmpdir) as (f, fst):
+                    stats['size'] = fst.st_size
+                    return wheel_file.compressfile(wheel_file.fileinfo(arcname, fst), f)
         except FileNotFoundError:
             # work around for Meson bug, see https://github.com/mesonbuild/meson/pull/11655
             if not os.fspath(origin).endswith('.pdb'):
                 raise
+        return None
+
+    def _duplicate_path(
+        self, wheel_file: mesonpy._wheelfile.WheelFile, index: Optional[mesonpy._wheelfile.WheelIndex],
+        origin: Path, arcname: str, st: os.stat_result, original: str, tmpdir: pathlib.Path
+    ) -> None:
+        """Add a file with the same content as a file already added to the wheel."""
+        with self._phase('file', path=arcname) as stats:
+            zinfo = wheel_file.fileinfo(arcname, st)
+            if index is not None:
+                index.record(zinfo, origin, st)
+            if (self._has_internal_libs or self._debug_symbols is not None) and self._is_native(origin):
+                # Native files may be modified when added to the wheel,
+                # depending on where they are installed. The content is
+                # copied only if the modified file is also the same.
+                with self._open(origin, arcname, tmpdir) as (f, fst):
+                    zinfo = wheel_file.fileinfo(arcname, fst)
+                    if wheel_file.hashfile(f) != wheel_file.digest(original):
+                        f.seek(0)
+                        stats['size'] = fst.st_size
+                        wheel_file.writefile(zinfo, f, fst.st_size)
+                        return
+            stats['duplicate'] = original
+            wheel_file.writecopy(zinfo, original)
+
+    def _duplicates(
+        self,
+        wheel_file: mesonpy._wheelfile.WheelFile,
+        files: List[Tuple[str, str, Optional[os.stat_result]]],
+        executor: Optional[concurrent.futures.Executor] = None,
+    ) -> Dict[int, int]:
+        """Find the files with the same content as a file preceding them.
+
+        Returns a mapping from the position of these files to the
+        position of the first file with the same content. Only files
+        with the same size, not smaller than the configured bound, and
+        the same compression method are hashed, on the worker threads
+        of the executor, if given.
+        """
+        candidates: Dict[Tuple[int, int], List[int]] = collections.defaultdict(list)
+        for i, (src, dst, st) in enumerate(files):
+            if st is not None and st.st_size >= _DUPLICATE_MIN_SIZE:
+                candidates[(st.st_size, wheel_file.compress_type(dst))].append(i)
+
+        groups = [group for group in candidates.values() if len(group) > 1]
+        hashed = [i for group in groups for i in group]
+        srcs = [files[i][0] for i in hashed]
+        digests = dict(zip(hashed, executor.map(mesonpy._wheelfile.file_digest, srcs) if executor else
+                           map(mesonpy._wheelfile.file_digest, srcs)))
+
+        duplicates = {}
+        for group in groups:
+            first: Dict[bytes, int] = {}
+            for i in group:
+                j = first.setdefault(digests[i], i)
+                if j != i:
+                    duplicates[i] = j
+
+        if duplicates:
+            warnings.warn('Identical files installed in several locations, compressed only once:\n' + '\n'.join(
+                f'  {files[i][1]} (same as {files[j][1]})' for i, j in sorted(duplicates.items())))
+        return duplicates
 
     def _wheel_write_metadata(self, whl: mesonpy._wheelfile.WheelFile) -> None:
         # add metadata
@@ -457,28 +725,153 @@ class _WheelBuilder():
         if self._license_file:
             whl.write(self._license_file, f'{self._distinfo_dir}/{os.path.basename(self._license_file)}')
 
-    def build(self, directory: Path) -> pathlib.Path:
-        wheel_file = pathlib.Path(directory, f'{self.name}.whl')
-        with mesonpy._wheelfile.WheelFile(wheel_file, 'w') as whl:
-            self._wheel_write_metadata(whl)
-
-            with _clicounter(sum(len(x) for x in self._manifest.values())) as counter:
-
-                root = 'purelib' if self._pure else 'platlib'
+    def write_metadata(self, directory: Path) -> pathlib.Path:
+        """Write the metadata files to a .dist-info directory in the specified directory.
 
-                for path, entries in self._manifest.items():
-                    for dst, src in entries:
-                        counter.update(src)
+        These are the files added to the wheel .dist-info directory,
+        except RECORD.
+        """
+        distinfo = pathlib.Path(directory, self._distinfo_dir)
+        distinfo.mkdir(parents=True, exist_ok=True)
+        distinfo.joinpath('METADATA').write_bytes(bytes(self._metadata.as_rfc822()))
+        distinfo.joinpath('WHEEL').write_bytes(self.wheel)
+        if self.entrypoints_txt:
+            distinfo.joinpath('entry_points.txt').write_bytes(self.entrypoints_txt)
+        if self._license_file:
+            shutil.copyfile(self._license_file, distinfo / os.path.basename(self._license_file))
+        return distinfo
+
+    def _wheel_open(self, wheel_file: pathlib.Path) -> mesonpy._wheelfile.WheelFile:
+        # Following the zip(1) command semantics, compression level 0
+        # stores the files without compression.
+        if self._compression_level == 0:
+            return mesonpy._wheelfile.WheelFile(
+                wheel_file, 'w', compression=zipfile.ZIP_STORED, methods=self._compression_methods)
+        return mesonpy._wheelfile.WheelFile(
+            wheel_file, 'w', compresslevel=self._compression_level, methods=self._compression_methods)
 
-                        if path == root:
-                            pass
-                        elif path == 'mesonpy-libs':
-                            # custom installation path for bundled libraries
-                            dst = pathlib.Path(self._libs_dir, dst)
-                        else:
-                            dst = pathlib.Path(self._data_dir, path, dst)
+    @property
+    def _files(self) -> List[Tuple[str, str, Optional[os.stat_result]]]:
+        """The source, archive member name, and source status of the files to be added to the wheel.
+
+        The member names are computed once for the whole manifest, to
+        keep the work done for each file, possibly on a large number of
+        files, to a minimum.
+        """
+        root = 'purelib' if self._pure else 'platlib'
+        files = []
+        for path, entries in self._manifest.items():
+            if path == root:
+                prefix = ''
+            elif path == 'mesonpy-libs':
+                # custom installation path for bundled libraries
+                prefix = f'{self._libs_dir}/'
+            else:
+                prefix = f'{self._data_dir}/{path}/'
+            files.extend((src, prefix + dst, st) for dst, src, st in entries)
+        return files
+
+    def _wheel_write(self, whl: mesonpy._wheelfile.WheelFile, index: Optional[mesonpy._wheelfile.WheelIndex]) -> None:
+        self._wheel_write_metadata(whl)
+
+        files = self._files
+
+        if self._debug_symbols is not None:
+            # Move the PDB files to the debug symbols archive.
+            self._debug_files = [(pathlib.Path(src), dst) for src, dst, _ in files if dst.endswith('.pdb')]
+            files = [(src, dst, st) for src, dst, st in files if not dst.endswith('.pdb')]
+
+        with contextlib.ExitStack() as stack:
+            counter = stack.enter_context(_clicounter(len(files)))
+            tmpdir = pathlib.Path(stack.enter_context(tempfile.TemporaryDirectory()))
+            if self._debug_symbols is not None:
+                self._debug_dir = pathlib.Path(stack.enter_context(tempfile.TemporaryDirectory()))
+                stack.callback(setattr, self, '_debug_dir', None)
+            executor = stack.enter_context(concurrent.futures.ThreadPoolExecutor(self._jobs)) if self._jobs > 1 else None
+
+            # Files with the same content as a preceding file reuse its
+            # compressed data, copied from the archive being written.
+            duplicates = self._duplicates(whl, files, executor)
+
+            def duplicate(i: int) -> None:
+                src, dst, st = files[i]
+                assert st is not None  # help mypy out
+                self._duplicate_path(whl, index, src, dst, st, files[duplicates[i]][1], tmpdir)
+
+            if executor is not None:
+                # Compress and relocate files on a pool of worker threads
+                # and add them to the archive in manifest order. The
+                # resulting archive is byte-for-byte identical to the one
+                # produced adding the files one at a time. The workers
+                # compress the members in memory, thus files larger than a
+                # chunk are left to be streamed to the archive in order.
+                def compress(i: int) -> Optional[mesonpy._wheelfile.CompressedMember]:
+                    src, dst, st = files[i]
+                    if i in duplicates or st is not None and st.st_size > mesonpy._wheelfile.CHUNK_SIZE:
+                        return None
+                    return self._compress_path(whl, index, src, dst, st, tmpdir)
+
+                members = mesonpy._util.imap(executor, compress, range(len(files)), 2 * self._jobs)
+                for i, member in enumerate(members):
+                    src, dst, st = files[i]
+                    counter.update(src)
+                    if i in duplicates:
+                        duplicate(i)
+                    elif member is not None:
+                        whl.writecompressed(member)
+                    else:
+                        self._install_path(whl, index, src, dst, st, tmpdir)
+            else:
+                for i, (src, dst, st) in enumerate(files):
+                    counter.update(src)
+                    if i in duplicates:
+                        duplicate(i)
+                    else:
+                        self._install_path(whl, index, src, dst, st, tmpdir)
+
+            # Written only when all the files have been added, not to
+            # leave behind a partial archive.
+            if self._debug_symbols is not None:
+                self._write_debug_symbols()
+
+    def _write_debug_symbols(self) -> None:
+        """Write the debug symbols archive accompanying the wheel."""
+        assert self._debug_symbols is not None  # help mypy out
+        path = self._debug_symbols / f'{self.name}.debug.zip'
+        files = sorted((name, src) for src, name in self._debug_files if os.path.isfile(src))
+        if not files:
+            with contextlib.suppress(FileNotFoundError):
+                path.unlink()
+            return
+        # Like the wheel, the archive does not depend on the files
+        # modification time and permissions, to be reproducible.
+        with zipfile.ZipFile(path, 'w', compression=zipfile.ZIP_DEFLATED) as archive:
+            for name, src in files:
+                zinfo = zipfile.ZipInfo(name, date_time=mesonpy._wheelfile.WheelFile.timestamp())
+                zinfo.external_attr = 0o664 << 16
+                zinfo.compress_type = zipfile.ZIP_DEFLATED
+                with open(src, 'rb') as f, archive.open(zinfo, 'w') as member:
+                    shutil.copyfileobj(f, member, mesonpy._wheelfile.CHUNK_SIZE)
 
-                        self._install_path(whl, src, dst)
+    def build(self, directory: Path) -> pathlib.Path:
+        wheel_file = pathlib.Path(directory, f'{self.name}.whl')
+        if self._index_file is None:
+            with self._wheel_open(wheel_file) as whl:
+                self._wheel_write(whl, None)
+            return wheel_file
+
+        # Members added from files not modified since the previous build
+        # are copied from the previous wheel. The new wheel may replace
+        # the previous one, thus it is written to a temporary location
+        # and moved in place when complete.
+        key = {'libs': self._libs_dir if self._has_internal_libs else None, 'strip': self._debug_symbols is not None}
+        with tempfile.TemporaryDirectory(prefix='.mesonpy-', dir=directory) as tmp:
+            partial = pathlib.Path(tmp, wheel_file.name)
+            with mesonpy._wheelfile.WheelIndex(self._index_file, key) as index:
+                with self._wheel_open(partial) as whl:
+                    self._wheel_write(whl, index)
+            os.replace(partial, wheel_file)
+            index.save(typing.cast('mesonpy._wheelfile.WheelFileWriter', whl), wheel_file)
 
         return wheel_file
 
@@ -489,8 +882,8 @@ class _EditableWheelBuilder(_WheelBuilder):
     def _top_level_modules(self) -> Collection[str]:
         modules = set()
         for type_ in self._manifest:
-            for path, _ in self._manifest[type_]:
-                name, dot, ext = path.parts[0].partition('.')
+            for path, _, _ in self._manifest[type_]:
+                name, dot, ext = path.split('/', 1)[0].partition('.')
                 if dot:
                     # module
                     suffix = dot + ext
@@ -557,6 +950,22 @@ def _validate_pyproject_config(pyproject: Dict[str, Any]) -> Dict[str, Any]:
             raise ConfigError(f'Configuration entry "{name}" must be a boolean')
         return value
 
+    def _compression_level(value: Any, name: str) -> int:
+        if not isinstance(value, int) or isinstance(value, bool) or not 0 <= value <= 9:
+            raise ConfigError(f'Configuration entry "{name}" must be an integer between 0 and 9')
+        return value
+
+    def _compression_methods(value: Any, name: str) -> Dict[str, int]:
+        if not isinstance(value, dict):
+            raise ConfigError(f'Configuration entry "{name}" must be a table')
+        methods = {}
+        for suffix, method in value.items():
+            if not suffix.startswith('.') or not isinstance(method, str) or method not in _WHEEL_COMPRESSION_METHODS:
+                raise ConfigError(f'Configuration entry "{name}" must map file name suffixes, starting with ".", '
+                                  f'to "stored" or "deflated"')
+            methods[suffix] = _WHEEL_COMPRESSION_METHODS[method]
+        return methods
+
     def _string_or_path(value: Any, name: str) -> str:
         if not isinstance(value, str):
             raise ConfigError(f'Configuration entry "{name}" must be a string')
@@ -567,6 +976,9 @@ def _validate_pyproject_config(pyproject: Dict[str, Any]) -> Dict[str, Any]:
     scheme = _table({
         'meson': _string_or_path,
         'limited-api': _bool,
+        'wheel-compression-level': _compression_level,
+        'wheel-compression-methods': _compression_methods,
+        'pgo-training': _strings,
         'args': _table({
             name: _strings for name in _MESON_ARGS_KEYS
         }),
@@ -590,10 +1002,76 @@ def _validate_config_settings(config_settings: Dict[str, Any]) -> Dict[str, Any]
     def _string_or_strings(value: Any, name: str) -> List[str]:
         return list([value,] if isinstance(value, str) else value)
 
+    def _positive_int(value: Any, name: str) -> int:
+        value = _string(value, name)
+        if not value.isdigit() or int(value) < 1:
+            raise ConfigError(f'The value for "{name}" must be a positive integer')
+        return int(value)
+
+    def _build_jobs(value: Any, name: str) -> int:
+        value = _string(value, name)
+        if value == 'auto':
+            return 0
+        if not value.isdigit() or int(value) < 1:
+            raise ConfigError(f'The value for "{name}" must be a positive integer or "auto"')
+        return int(value)
+
+    def _build_profile(value: Any, name: str) -> str:
+        value = _string(value, name)
+        if value not in _BUILD_PROFILES:
+            alternatives = ', '.join(f'"{x}"' for x in _BUILD_PROFILES)
+            raise ConfigError(f'The value for "{name}" must be one of {alternatives}')
+        return value
+
+    def _compiler_cache(value: Any, name: str) -> str:
+        value = _string(value, name)
+        if value not in {'ccache', 'sccache'}:
+            raise ConfigError(f'The value for "{name}" must be "ccache" or "sccache"')
+        return value
+
+    def _timing_report(value: Any, name: str) -> str:
+        value = _string(value, name)
+        if value not in {'json', 'trace'}:
+            raise ConfigError(f'The value for "{name}" must be "json" or "trace"')
+        return value
+
+    def _compression_level(value: Any, name: str) -> int:
+        value = _string(value, name)
+        if value not in {str(x) for x in range(10)}:
+            raise ConfigError(f'The value for "{name}" must be an integer between 0 and 9')
+        return int(value)
+
+    def _sdist_compression(value: Any, name: str) -> str:
+        value = _string(value, name)
+        if value not in mesonpy._util.SDIST_COMPRESSION:
+            raise ConfigError(f'The value for "{name}" must be "gzip" or "zstd"')
+        if value == 'zstd' and not mesonpy._util.zstd_available():
+            raise ConfigError(f'The value "zstd" for "{name}" requires Python 3.14 or the "zstandard" package')
+        return value
+
+    def _sdist_compression_level(value: Any, name: str) -> int:
+        value = _string(value, name)
+        if not re.fullmatch(r'[0-9]+', value):
+            raise ConfigError(f'The value for "{name}" must be an integer')
+        return int(value)
+
     options = {
         'builddir': _string,
         'build-dir': _string,
         'editable-verbose': _bool,
+        'build-jobs': _build_jobs,
+        'build-job-memory': _positive_int,
+        'build-profile': _build_profile,
+        'compiler-cache': _compiler_cache,
+        'compiler-cache-dir': _string,
+        'pgo': _bool,
+        'strip': _bool,
+        'wheel-jobs': _positive_int,
+        'wheel-compression-level': _compression_level,
+        'sdist-jobs': _positive_int,
+        'sdist-compression': _sdist_compression,
+        'sdist-compression-level': _sdist_compression_level,
+        'timing-report': _timing_report,
         'dist-args': _string_or_strings,
         'setup-args': _string_or_strings,
         'compile-args': _string_or_strings,
@@ -623,6 +1101,15 @@ def _validate_config_settings(config_settings: Dict[str, Any]) -> Dict[str, Any]
         if alt in config:
             config[key] = config[alt]
 
+    # Check the sdist compression level against the range supported by
+    # the compression method.
+    if 'sdist-compression-level' in config:
+        compression = config.get('sdist-compression', 'gzip')
+        low, high = {'gzip': (0, 9), 'zstd': (1, 22)}[compression]
+        if not low <= config['sdist-compression-level'] <= high:
+            raise ConfigError(f'The value for "sdist-compression-level" must be an integer '
+                              f'between {low} and {high} with "{compression}" compression')
+
     return config
 
 
@@ -635,14 +1122,53 @@ class Project():
         build_dir: Path,
         meson_args: Optional[MesonArgs] = None,
         editable_verbose: bool = False,
+        wheel_jobs: int = 1,
+        wheel_compression_level: Optional[int] = None,
+        sdist_jobs: int = 1,
+        timing_report: Optional[str] = None,
+        build_jobs: Optional[int] = None,
+        build_job_memory: Optional[int] = None,
+        compiler_cache: Optional[str] = None,
+        compiler_cache_dir: Optional[str] = None,
+        pgo: bool = False,
+        build_profile: Optional[str] = None,
+        strip: bool = False,
+        sdist_compression: str = 'gzip',
+        sdist_compression_level: Optional[int] = None,
     ) -> None:
         self._source_dir = pathlib.Path(source_dir).absolute()
         self._build_dir = pathlib.Path(build_dir).absolute()
         self._editable_verbose = editable_verbose
+        self._wheel_jobs = wheel_jobs
+        self._sdist_jobs = sdist_jobs
+        self._sdist_compression = sdist_compression
+        self._sdist_compression_level = sdist_compression_level
+        self._timing_report = timing_report
+        self._timings = mesonpy._util.Timings() if timing_report else None
+
+        # ninja parallelism, determined from the CPUs and the memory
+        # available to the process when 'build-jobs' is 'auto' or when
+        # only a memory budget per job is given
+        self._parallelism: List[str] = []
+        if build_jobs == 0 or (build_jobs is None and build_job_memory):
+            jobs, load = mesonpy._util.build_parallelism(build_job_memory * 2**20 if build_job_memory else None)
+            self._parallelism = [f'-j{jobs}', f'-l{load:g}']
+        elif build_jobs:
+            self._parallelism = [f'-j{build_jobs}']
+
         self._meson_native_file = self._build_dir / 'meson-python-native-file.ini'
         self._meson_cross_file = self._build_dir / 'meson-python-cross-file.ini'
+        self._meson_setup_fingerprint = self._build_dir / 'meson-python-setup-fingerprint'
+        self._meson_setup_environment = self._build_dir / 'meson-python-setup-environment.json'
+        self._meson_compiler_cache = self._build_dir / 'meson-python-compiler-cache.json'
+        # environment variables set for the commands run to build the project
+        self._environment: Dict[str, str] = {}
         self._meson_args: MesonArgs = collections.defaultdict(list)
         self._limited_api = False
+        self._pgo: Optional[str] = None
+        self._build_profile = build_profile
+        self._strip = strip
+        self._thin_lto = False
 
         # load pyproject.toml
         pyproject = tomllib.loads(self._source_dir.joinpath('pyproject.toml').read_text(encoding='utf-8'))
@@ -652,6 +1178,23 @@ class Project():
         for key, value in pyproject_config.get('args', {}).items():
             self._meson_args[key].extend(value)
 
+        # the wheel compression level passed on the command line takes
+        # precedence over the one from the configuration file
+        if wheel_compression_level is None:
+            wheel_compression_level = pyproject_config.get('wheel-compression-level')
+        self._wheel_compression_level = wheel_compression_level
+        self._wheel_compression_methods: Optional[Dict[str, int]] = pyproject_config.get('wheel-compression-methods')
+
+        # profile-guided optimization: the project is configured for
+        # the instrumented build first, the training runs when a wheel
+        # is built
+        self._pgo_training: Optional[List[str]] = None
+        if pgo:
+            self._pgo_training = pyproject_config.get('pgo-training')
+            if self._pgo_training is None:
+                raise ConfigError('The "pgo" setting requires the "tool.meson-python.pgo-training" configuration entry')
+            self._pgo = 'generate'
+
         # meson arguments from the command line take precedence over
         # arguments from the configuration file thus are added later
         if meson_args:
@@ -666,6 +1209,21 @@ class Project():
             raise ConfigError(f'Could not find ninja version {_NINJA_REQUIRED_VERSION} or newer.')
         os.environ.setdefault('NINJA', self._ninja)
 
+        # the build profile environment affects the compilers detection
+        if build_profile is not None:
+            self._environment.update(_build_profile_environment(build_profile))
+
+        # wire in the compiler cache before the compilers are detected
+        if compiler_cache is not None:
+            self._environment.update(_compiler_cache_environment(compiler_cache, compiler_cache_dir, self._source_dir))
+            # the compilers specified when the build directory was set up
+            try:
+                data = json.loads(self._meson_compiler_cache.read_text(encoding='utf-8'))
+                if data['tool'] == compiler_cache:
+                    self._environment.update((k, v) for k, v in data['compilers'].items() if k not in os.environ)
+            except (OSError, ValueError, KeyError, TypeError, AttributeError):
+                pass
+
         # make sure the build dir exists
         self._build_dir.mkdir(exist_ok=True, parents=True)
 
@@ -702,7 +1260,7 @@ class Project():
                         cpu_family = {family!r}
                         endian = 'little'
                     ''')
-                    self._meson_cross_file.write_text(cross_file_data, encoding='utf-8')
+                    mesonpy._util.update_file(self._meson_cross_file, cross_file_data)
                     self._meson_args['setup'].extend(('--cross-file', os.fspath(self._meson_cross_file)))
 
         # write the native file
@@ -710,7 +1268,7 @@ class Project():
             [binaries]
             python = '{sys.executable}'
         ''')
-        self._meson_native_file.write_text(native_file_data, encoding='utf-8')
+        mesonpy._util.update_file(self._meson_native_file, native_file_data)
 
         # reconfigure if we have a valid Meson build directory. Meson
         # uses the presence of the 'meson-private/coredata.dat' file
@@ -720,9 +1278,36 @@ class Project():
         # goes wrong during setup.
         reconfigure = self._build_dir.joinpath('meson-private/coredata.dat').is_file()
 
+        # ThinLTO is used when supported by the toolchain, which is known
+        # only once the project is configured. Use what was detected by a
+        # previous setup of the build directory, if any, to avoid
+        # configuring the project twice.
+        if build_profile == 'release-lto' and reconfigure:
+            self._thin_lto = _thin_lto_supported(self._build_dir)
+
         # run meson setup
         self._configure(reconfigure=reconfigure)
 
+        # Meson uses the compiler cache found in the path, preferring
+        # sccache, for the compilers not specified via the environment.
+        # When it is not the selected one, specify these compilers
+        # prefixed with the selected compiler cache.
+        if compiler_cache is not None:
+            compilers = _compiler_cache_compilers(compiler_cache, self._build_dir)
+            if compilers:
+                self._environment.update(compilers)
+                self._configure(reconfigure=True)
+            # Specify the same compilers in the following builds, which
+            # otherwise would set up the build directory again.
+            names = {'CC', 'CXX', 'OBJC', 'OBJCXX'}
+            compilers = {k: v for k, v in self._environment.items() if k in names and k not in os.environ}
+            data = json.dumps({'tool': compiler_cache, 'compilers': compilers})
+            mesonpy._util.update_file(self._meson_compiler_cache, data)
+
+        if build_profile == 'release-lto' and not self._thin_lto and _thin_lto_supported(self._build_dir):
+            self._thin_lto = True
+            self._configure(reconfigure=True)
+
         # package metadata
         if 'project' in pyproject:
             self._metadata = Metadata.from_pyproject(pyproject, self._source_dir)
@@ -763,13 +1348,15 @@ class Project():
                 'The package targets Python\'s Limited API, which is not supported by free-threaded CPython. '
                 'The "python.allow_limited_api" Meson build option may be used to override the package default.')
 
-    def _run(self, cmd: Sequence[str]) -> None:
+    def _run(self, cmd: Sequence[str], cwd: Optional[Path] = None, env: Optional[Dict[str, str]] = None) -> None:
         """Invoke a subprocess."""
         # Flush the line to ensure that the log line with the executed
         # command line appears before the command output. Without it,
         # the lines appear in the wrong order in pip output.
         _log('{style.INFO}+ {cmd}{style.RESET}'.format(style=style, cmd=' '.join(cmd)), flush=True)
-        r = subprocess.run(cmd, cwd=self._build_dir)
+        if self._environment:
+            env = {**(os.environ if env is None else env), **self._environment}
+        r = subprocess.run(cmd, cwd=self._build_dir if cwd is None else cwd, env=env)
         if r.returncode != 0:
             raise SystemExit(r.returncode)
 
@@ -782,16 +1369,84 @@ class Project():
             '-Dbuildtype=release',
             '-Db_ndebug=if-release',
             '-Db_vscrt=md',
+            # build profile options
+            *self._build_profile_args,
             # user build options
             *self._meson_args['setup'],
+            # the profile-guided optimization stage takes precedence
+            *([f'-Db_pgo={self._pgo}'] if self._pgo else []),
             # pass native file last to have it override the python
             # interpreter path that may have been specified in user
             # provided native files
             f'--native-file={os.fspath(self._meson_native_file)}',
         ]
+        # Skip the reconfiguration when none of the inputs changed since
+        # the last successful setup. Changes to the project build
+        # definitions are tracked by Meson itself.
+        with self._phase('setup fingerprint'):
+            fingerprint = self._setup_fingerprint(setup_args)
+        env = {**os.environ, **self._environment}
+        compilers_env = {name: env.get(name) for name in _COMPILERS_ENVIRONMENT}
+        wipe = False
         if reconfigure:
-            setup_args.insert(0, '--reconfigure')
-        self._run(self._meson + ['setup', *setup_args])
+            try:
+                if self._meson_setup_fingerprint.read_text(encoding='utf-8') == fingerprint:
+                    return
+            except OSError:
+                pass
+            # Meson ignores the changes to the compilers environment
+            # when reconfiguring. Set up the build directory from
+            # scratch for them to take effect.
+            try:
+                data = self._meson_setup_environment.read_text(encoding='utf-8')
+                wipe = json.loads(data) != compilers_env
+            except (OSError, ValueError):
+                pass
+            setup_args.insert(0, '--wipe' if wipe else '--reconfigure')
+        try:
+            self._meson_setup_fingerprint.unlink()
+        except FileNotFoundError:
+            pass
+        with self._phase('meson setup'):
+            self._run(self._meson + ['setup', *setup_args])
+        if wipe or not reconfigure:
+            self._meson_setup_environment.write_text(json.dumps(compilers_env), encoding='utf-8')
+        self._meson_setup_fingerprint.write_text(fingerprint, encoding='utf-8')
+
+    @property
+    def _build_profile_args(self) -> List[str]:
+        """The Meson options selected by the build profile."""
+        if self._build_profile == 'release-lto':
+            jobs = math.ceil(mesonpy._util.cpu_limit())
+            return ['-Db_lto=true', f'-Db_lto_threads={jobs}', *(['-Db_lto_mode=thin'] if self._thin_lto else [])]
+        if self._build_profile == 'dev-fast':
+            return ['-Dbuildtype=debugoptimized']
+        return []
+
+    def _setup_fingerprint(self, setup_args: List[str]) -> str:
+        """Identify the inputs of the Meson project setup."""
+        # Content of the machine files, relative paths are resolved
+        # from the build directory where Meson is run.
+        files: Dict[str, Optional[str]] = {}
+        args = iter(setup_args)
+        for arg in args:
+            option, eq, value = arg.partition('=')
+            if option in {'--native-file', '--cross-file'}:
+                path = value if eq else next(args, '')
+                try:
+                    data = self._build_dir.joinpath(path).read_bytes()
+                    files[path] = hashlib.sha256(data).hexdigest()
+                except OSError:
+                    files[path] = None
+        inputs = {
+            'meson': self._meson,
+            'meson-version': _run_probe(self._meson + ['--version']).stdout,
+            'args': setup_args,
+            'files': files,
+            'python': [sys.executable, sys.version],
+            'env': {name: self._environment.get(name, os.environ.get(name)) for name in _SETUP_ENVIRONMENT},
+        }
+        return hashlib.sha256(json.dumps(inputs, sort_keys=True).encode()).hexdigest()
 
     @property
     def _build_command(self) -> List[str]:
@@ -802,16 +1457,33 @@ class Project():
             # provide the exact same semantics for the compile arguments
             # provided by the users.
             cmd = self._meson + ['compile']
-            args = list(self._meson_args['compile'])
+            args = [*self._parallelism, *self._meson_args['compile']]
             if args:
                 cmd.append(f'--ninja-args={args!r}')
             return cmd
-        return [self._ninja, *self._meson_args['compile']]
+        return [self._ninja, *self._parallelism, *self._meson_args['compile']]
+
+    def _phase(self, name: str, **args: Any) -> ContextManager[Dict[str, Any]]:
+        """Time a phase of the build, when timings are recorded."""
+        if self._timings is None:
+            return contextlib.nullcontext(args)
+        return self._timings.phase(name, **args)
+
+    def _write_timings(self) -> None:
+        """Write the timing report, when requested, to the build directory."""
+        if self._timings is None:
+            return
+        trace = self._build_dir / 'meson-python-timings.trace.json' if self._timing_report == 'trace' else None
+        self._timings.write(self._build_dir / 'meson-python-timings.json', trace)
 
     @functools.lru_cache(maxsize=None)
     def build(self) -> None:
         """Build the Meson project."""
-        self._run(self._build_command)
+        self._compile()
+
+    def _compile(self) -> None:
+        with self._phase('meson compile'):
+            self._run(self._build_command)
 
     @functools.lru_cache()
     def _info(self, name: str) -> Any:
@@ -820,7 +1492,7 @@ class Project():
         return json.loads(info.read_text(encoding='utf-8'))
 
     @property
-    def _manifest(self) -> DefaultDict[str, List[Tuple[pathlib.Path, str]]]:
+    def _manifest(self) -> Manifest:
         """The files to be added to the wheel, organized by wheel path."""
 
         # Obtain the list of files Meson would install.
@@ -848,6 +1520,17 @@ class Project():
         # Map Meson installation locations to wheel paths.
         return _map_to_wheel(sources)
 
+    @property
+    def _native_files(self) -> Dict[str, bool]:
+        """Whether the files built by Meson targets are native files, indexed by normalized path."""
+        native_files = {}
+        for target in self._info('intro-targets'):
+            native = _NATIVE_TARGET_TYPES.get(target['type'])
+            if native is not None:
+                for filename in target['filename']:
+                    native_files[os.path.normpath(filename)] = native
+        return native_files
+
     @property
     def _meson_name(self) -> str:
         """Name in meson.build."""
@@ -864,19 +1547,29 @@ class Project():
 
     def sdist(self, directory: Path) -> pathlib.Path:
         """Generates a sdist (source distribution) in the specified directory."""
-        # Generate meson dist file.
-        self._run(self._meson + ['dist', '--allow-dirty', '--no-tests', '--formats', 'gztar', *self._meson_args['dist']])
+        # Generate meson dist file. Of the formats supported by 'meson
+        # dist', gzip is the fastest to decompress. The archive is read
+        # only once, and the sdist is compressed with the configured method.
+        with self._phase('meson dist'):
+            self._run(self._meson + ['dist', '--allow-dirty', '--no-tests', '--formats', 'gztar', *self._meson_args['dist']])
 
         dist_name = f'{self._metadata.distribution_name}-{self._metadata.version}'
         meson_dist_name = f'{self._meson_name}-{self._meson_version}'
         meson_dist_path = pathlib.Path(self._build_dir, 'meson-dist', f'{meson_dist_name}.tar.gz')
-        sdist_path = pathlib.Path(directory, f'{dist_name}.tar.gz')
+        extension, _ = mesonpy._util.SDIST_COMPRESSION[self._sdist_compression]
+        sdist_path = pathlib.Path(directory, f'{dist_name}{extension}')
         pyproject_toml_mtime = 0
 
-        with tarfile.open(meson_dist_path, 'r:gz') as meson_dist, mesonpy._util.create_targz(sdist_path) as sdist:
-            for member in meson_dist.getmembers():
+        # Read the archive generated by 'meson dist' as a stream, to
+        # decompress it in a single pass, and copy each member as it is
+        # read. The member data is copied in bounded chunks.
+        with self._phase('sdist', path=os.fspath(sdist_path)), \
+                tarfile.open(meson_dist_path, 'r|gz') as meson_dist, \
+                mesonpy._util.create_targz(sdist_path, self._sdist_jobs, self._sdist_compression,
+                                           self._sdist_compression_level) as sdist:
+            for member in meson_dist:
                 if member.isfile():
-                    file = meson_dist.extractfile(member.name)
+                    file = meson_dist.extractfile(member)
 
                     # Reset pax extended header.  The tar archive member may be
                     # using pax headers to store some file metadata.  The pax
@@ -934,35 +1627,171 @@ class Project():
             member.size = len(metadata)
             sdist.addfile(member, io.BytesIO(metadata))
 
+        self._write_timings()
         return sdist_path
 
+    @contextlib.contextmanager
+    def _pgo_stage(self, name: str) -> Iterator[None]:
+        start = time.perf_counter()
+        with self._phase(f'pgo {name}'):
+            yield
+        _log('{style.INFO}PGO {name} took {duration:.1f} s{style.RESET}'.format(
+            style=style, name=name, duration=time.perf_counter() - start), flush=True)
+
+    def _pgo_train(self) -> None:
+        """Build the project with profile-guided optimization."""
+        assert self._pgo_training is not None  # help mypy out
+        with self._pgo_stage('instrumented build'):
+            if self._pgo != 'generate':
+                self._pgo = 'generate'
+                self._configure(reconfigure=True)
+            self._compile()
+
+        # Remove the profile data recorded by previous trainings. GCC
+        # writes it next to the object files, Clang where instructed.
+        for pattern in '*.gcda', 'meson-python-pgo-*.profraw', 'default.profdata':
+            for path in self._build_dir.rglob(pattern):
+                path.unlink()
+
+        with self._pgo_stage('training'), \
+                tempfile.TemporaryDirectory(prefix='.mesonpy-pgo-', dir=self._build_dir) as tmp:
+            # Install the instrumented build where the training command
+            # can import it from. Using a wheel takes care of setting up
+            # the internal shared libraries.
+            builder = _WheelBuilder(
+                self._metadata, self._manifest, self._limited_api, self._wheel_jobs, 0, self._native_files)
+            with zipfile.ZipFile(builder.build(tmp)) as wheel:
+                wheel.extractall(os.path.join(tmp, 'site'))
+            env = os.environ.copy()
+            env['PYTHONPATH'] = os.pathsep.join(filter(None, (os.path.join(tmp, 'site'), env.get('PYTHONPATH'))))
+            env['LLVM_PROFILE_FILE'] = os.path.join(self._build_dir, 'meson-python-pgo-%p.profraw')
+            self._run([sys.executable, *self._pgo_training], cwd=self._source_dir, env=env)
+
+        # Clang requires the raw profile data to be merged, Meson
+        # instructs it to use the merged data from the build directory.
+        profiles = sorted(os.fspath(path) for path in self._build_dir.glob('meson-python-pgo-*.profraw'))
+        if profiles:
+            profdata = os.environ.get('LLVM_PROFDATA') or shutil.which('llvm-profdata')
+            if profdata is None:
+                raise BuildError('Could not find llvm-profdata, required to merge the profile data recorded by Clang')
+            self._run([profdata, 'merge', '-output=default.profdata', *profiles])
+
+        with self._pgo_stage('optimized build'):
+            self._pgo = 'use'
+            self._configure(reconfigure=True)
+            # Rebuild the project, even when it has already been built
+            # in this process, before the reconfiguration.
+            self._compile()
+
+    def metadata(self, directory: Path) -> pathlib.Path:
+        """Generates the wheel metadata in the specified directory.
+
+        The wheel tag is determined from the install plan of the
+        configured project. The project is built only when it is needed
+        to tell whether the installed scripts are native files.
+        """
+        with self._phase('manifest'):
+            manifest = self._manifest
+            native_files = self._native_files
+        if any(os.path.normpath(file) not in native_files and st is None for _, file, st in manifest['scripts']):
+            self.build()
+        builder = _WheelBuilder(self._metadata, manifest, self._limited_api, native_files=native_files)
+        distinfo = builder.write_metadata(directory)
+        self._write_timings()
+        return distinfo
+
     def wheel(self, directory: Path) -> pathlib.Path:
         """Generates a wheel in the specified directory."""
-        self.build()
-        builder = _WheelBuilder(self._metadata, self._manifest, self._limited_api)
-        return builder.build(directory)
+        if self._pgo_training is not None:
+            self._pgo_train()
+        else:
+            self.build()
+        with self._phase('manifest'):
+            manifest = self._manifest
+            native_files = self._native_files
+        builder = _WheelBuilder(
+            self._metadata, manifest, self._limited_api, self._wheel_jobs, self._wheel_compression_level,
+            native_files, self._build_dir / 'meson-python-wheel-index.json', self._timings,
+            self._build_dir if self._strip else None, self._wheel_compression_methods)
+        with self._phase('wheel') as stats:
+            wheel = builder.build(directory)
+            stats['path'] = os.fspath(wheel)
+        self._write_timings()
+        return wheel
 
     def editable(self, directory: Path) -> pathlib.Path:
         """Generates an editable wheel in the specified directory."""
+        if self._pgo_training is not None:
+            raise ConfigError('Profile-guided optimization is not supported for editable installs')
         self.build()
-        builder = _EditableWheelBuilder(self._metadata, self._manifest, self._limited_api)
-        return builder.build(directory, self._source_dir, self._build_dir, self._build_command, self._editable_verbose)
+        with self._phase('manifest'):
+            manifest = self._manifest
+        builder = _EditableWheelBuilder(self._metadata, manifest, self._limited_api)
+        with self._phase('editable') as stats:
+            wheel = builder.build(directory, self._source_dir, self._build_dir, self._build_command, self._editable_verbose)
+            stats['path'] = os.fspath(wheel)
+        self._write_timings()
+        return wheel
+
+
+def _setenv(name: str, value: Optional[str]) -> None:
+    if value is None:
+        os.environ.pop(name, None)
+    else:
+        os.environ[name] = value
 
 
 @contextlib.contextmanager
-def _project(config_settings: Optional[Dict[Any, Any]] = None) -> Iterator[Project]:
-    """Create the project given the given config settings."""
+def _project(config_settings: Optional[Dict[Any, Any]] = None, default_build_dir: Optional[Path] = None) -> Iterator[Project]:
+    """Create the project given the given config settings.
+
+    When the build directory is not specified in the config settings,
+    the default build directory is used, if given, otherwise a
+    temporary build directory.
+    """
 
     settings = _validate_config_settings(config_settings or {})
     meson_args = typing.cast('MesonArgs', {name: settings.get(f'{name}-args', []) for name in _MESON_ARGS_KEYS})
     source_dir = os.path.curdir
-    build_dir = settings.get('build-dir')
+    build_dir = settings.get('build-dir', default_build_dir and os.fspath(default_build_dir))
     editable_verbose = bool(settings.get('editable-verbose'))
+    # Without the global interpreter lock, the worker threads hash,
+    # compress, and relocate the files in parallel.
+    wheel_jobs = settings.get('wheel-jobs', math.ceil(mesonpy._util.cpu_limit()) if mesonpy._util.gil_disabled() else 1)
+    wheel_compression_level = settings.get('wheel-compression-level')
+    sdist_jobs = settings.get('sdist-jobs', 1)
+    sdist_compression = settings.get('sdist-compression', 'gzip')
+    sdist_compression_level = settings.get('sdist-compression-level')
+    timing_report = settings.get('timing-report')
+    build_jobs = settings.get('build-jobs')
+    build_job_memory = settings.get('build-job-memory')
+    compiler_cache = settings.get('compiler-cache')
+    compiler_cache_dir = settings.get('compiler-cache-dir')
+    pgo = bool(settings.get('pgo'))
+    build_profile = settings.get('build-profile')
+    strip = bool(settings.get('strip'))
+    if strip and 'build-dir' not in settings:
+        # The debug information archive is written to the build directory,
+        # a temporary build directory would be removed along with it.
+        raise ConfigError('The "strip" setting requires the "build-dir" setting')
 
     with contextlib.ExitStack() as ctx:
         if build_dir is None:
             build_dir = ctx.enter_context(tempfile.TemporaryDirectory(prefix='.mesonpy-', dir=source_dir))
-        yield Project(source_dir, build_dir, meson_args, editable_verbose)
+        else:
+            # Serialize the builds sharing a build directory, such as the
+            # wheel builds for several Python interpreters or the rebuilds
+            # started by an editable install. The editable install loader
+            # does not rebuild the project while it is being built.
+            os.makedirs(build_dir, exist_ok=True)
+            ctx.enter_context(mesonpy._editable.build_lock(build_dir))
+            marker = os.environ.get(mesonpy._editable.MARKER)
+            path = os.fspath(pathlib.Path(build_dir).absolute())
+            os.environ[mesonpy._editable.MARKER] = os.pathsep.join(x for x in (marker, path) if x)
+            ctx.callback(_setenv, mesonpy._editable.MARKER, marker)
+        yield Project(source_dir, build_dir, meson_args, editable_verbose, wheel_jobs, wheel_compression_level,
+                      sdist_jobs, timing_report, build_jobs, build_job_memory, compiler_cache, compiler_cache_dir,
+                      pgo, build_profile, strip, sdist_compression, sdist_compression_level)
 
 
 def _parse_version_string(string: str) -> Tuple[int, ...]:
@@ -973,6 +1802,80 @@ def _parse_version_string(string: str) -> Tuple[int, ...]:
         return (0, )
 
 
+def _cache_dir() -> pathlib.Path:
+    """Directory where data is cached across invocations."""
+    if sys.platform == 'win32':
+        base = os.environ.get('LOCALAPPDATA') or os.path.expanduser('~/AppData/Local')
+    elif sys.platform == 'darwin':
+        base = os.path.expanduser('~/Library/Caches')
+    else:
+        base = os.environ.get('XDG_CACHE_HOME') or os.path.expanduser('~/.cache')
+    return pathlib.Path(base, 'meson-python')
+
+
+_PROBE_CACHE_SIZE = 64
+
+
+def _run_probe(cmd: List[str]) -> subprocess.CompletedProcess[str]:
+    """Run a command probing an external tool, caching the result.
+
+    The output of successful runs is cached, keyed on the resolved path,
+    size, and modification time of the executable and of the arguments
+    referring to files, thus the cached result is discarded when any of
+    them is replaced. The processes executing the build backend hooks
+    can thus skip running the same probes over and over again.
+    """
+    key = []
+    for i, arg in enumerate(cmd):
+        path = shutil.which(arg) if i == 0 else arg if os.path.isfile(arg) else None
+        if path is None:
+            if i == 0:
+                # Cannot identify the executable.
+                return subprocess.run(cmd, text=True, capture_output=True)
+            key.append(arg)
+            continue
+        try:
+            path = os.path.realpath(path)
+            st = os.stat(path)
+        except OSError:
+            return subprocess.run(cmd, text=True, capture_output=True)
+        key.append([path, st.st_size, st.st_mtime_ns])
+    keystr = json.dumps(key)
+
+    cache_file = _cache_dir() / 'probes.json'
+    cache: Dict[str, Dict[str, str]] = {}
+    try:
+        cache = json.loads(cache_file.read_text(encoding='utf-8'))
+        entry = cache[keystr]
+        return subprocess.CompletedProcess(cmd, 0, entry['stdout'], entry['stderr'])
+    except (OSError, ValueError, KeyError, TypeError):
+        if not isinstance(cache, dict):
+            cache = {}
+
+    r = subprocess.run(cmd, text=True, capture_output=True)
+    if r.returncode == 0:
+        cache.pop(keystr, None)
+        cache[keystr] = {'stdout': r.stdout, 'stderr': r.stderr}
+        # Keep the most recently added entries only.
+        cache = dict(list(cache.items())[-_PROBE_CACHE_SIZE:])
+        tmp = None
+        try:
+            cache_file.parent.mkdir(parents=True, exist_ok=True)
+            with tempfile.NamedTemporaryFile('w', dir=cache_file.parent, delete=False, encoding='utf-8') as f:
+                tmp = f.name
+                json.dump(cache, f)
+            os.replace(tmp, cache_file)
+            tmp = None
+        except OSError:
+            pass
+        finally:
+            # do not leave the temporary file behind when writing fails
+            if tmp is not None:
+                with contextlib.suppress(OSError):
+                    os.unlink(tmp)
+    return r
+
+
 def _get_meson_command(
         meson: Optional[str] = None, *, version: str = _MESON_REQUIRED_VERSION
     ) -> List[str]:
@@ -999,7 +1902,7 @@ def _get_meson_command(
     # but the corresponding meson command is not available in $PATH. Implement
     # a runtime check to verify that the build environment is setup correcly.
     try:
-        r = subprocess.run(cmd + ['--version'], text=True, capture_output=True)
+        r = _run_probe(cmd + ['--version'])
     except FileNotFoundError as err:
         raise ConfigError(f'meson executable "{meson}" not found') from err
     if r.returncode != 0:
@@ -1012,6 +1915,102 @@ def _get_meson_command(
     return cmd
 
 
+def _build_profile_environment(profile: str) -> Dict[str, str]:
+    """Returns the environment variables selected by the build profile."""
+    env = {}
+    if profile == 'dev-fast' and sys.platform.startswith('linux'):
+        # Use the fastest linker available that the compiler supports,
+        # unless one is specified: GCC supports mold since version 12.1.
+        for name, compiler in ('CC_LD', os.environ.get('CC', 'cc')), ('CXX_LD', os.environ.get('CXX', 'c++')):
+            if name not in os.environ:
+                linker = next((x for x in ('mold', 'lld') if _linker_supported(compiler.split(), x)), None)
+                if linker is not None:
+                    env[name] = linker
+        # Write the debug information to separate files that the linker
+        # does not need to process.
+        for name in 'CFLAGS', 'CXXFLAGS':
+            flags = os.environ.get(name, '')
+            if '-gsplit-dwarf' not in flags.split():
+                env[name] = f'{flags} -gsplit-dwarf'.strip()
+    return env
+
+
+def _linker_supported(compiler: List[str], linker: str) -> bool:
+    """Whether the compiler can use the given linker, and the linker is available."""
+    if not compiler or shutil.which(compiler[0]) is None:
+        return False
+    return _run_probe([*compiler, f'-fuse-ld={linker}', '-Wl,--version']).returncode == 0
+
+
+def _thin_lto_supported(build_dir: pathlib.Path) -> bool:
+    """Whether the toolchain detected in the build directory supports ThinLTO."""
+    try:
+        compilers = json.loads(build_dir.joinpath('meson-info', 'intro-compilers.json').read_text(encoding='utf-8'))
+        clang = [c for c in compilers['host'].values() if c.get('id') in {'clang', 'clang-cl'}]
+    except (OSError, ValueError, KeyError, AttributeError):
+        return False
+    # Meson supports ThinLTO only with Clang and these linkers, while
+    # it ignores the LTO mode for other compilers.
+    linkers = {'ld64', 'ld.gold', 'ld.lld', 'ld.mold', 'lld-link'}
+    return bool(clang) and all(c.get('linker_id') in linkers for c in clang)
+
+
+def _compiler_cache_environment(tool: str, cache_dir: Optional[str], source_dir: pathlib.Path) -> Dict[str, str]:
+    """Returns the environment variables setting up the compiler cache."""
+    if shutil.which(tool) is None:
+        raise ConfigError(f'Could not find compiler cache "{tool}"')
+    env = {}
+
+    # Meson uses a compiler cache found in the path when the compilers
+    # are not specified via environment variables. Otherwise, prefix
+    # the compilers with the compiler cache, unless already done.
+    for name in 'CC', 'CXX', 'OBJC', 'OBJCXX':
+        value = os.environ.get(name, '').strip()
+        if value:
+            program = os.path.basename(value.split()[0]).lower()
+            if program not in {'ccache', 'ccache.exe', 'sccache', 'sccache.exe'}:
+                env[name] = f'{tool} {value}'
+
+    if tool == 'ccache':
+        # Meson passes paths relative to the build directory to the
+        # compiler. Rewrite the absolute paths in the source directory
+        # to relative paths too, and do not include the build directory
+        # path, that for the default temporary build directory is random
+        # and unique to each build, in the cache lookup key.
+        if 'CCACHE_BASEDIR' not in os.environ:
+            env['CCACHE_BASEDIR'] = os.fspath(source_dir)
+        if 'CCACHE_HASHDIR' not in os.environ and 'CCACHE_NOHASHDIR' not in os.environ:
+            env['CCACHE_NOHASHDIR'] = '1'
+
+    if cache_dir is not None:
+        env['CCACHE_DIR' if tool == 'ccache' else 'SCCACHE_DIR'] = os.path.abspath(cache_dir)
+
+    return env
+
+
+def _compiler_cache_compilers(tool: str, build_dir: pathlib.Path) -> Dict[str, str]:
+    """Returns the environment variables specifying the compilers detected in the build
+    directory prefixed with the compiler cache, for the compilers not already using it."""
+    try:
+        compilers = json.loads(build_dir.joinpath('meson-info', 'intro-compilers.json').read_text(encoding='utf-8'))
+        host = compilers['host']
+    except (OSError, ValueError, KeyError):
+        return {}
+    env = {}
+    for language, name in ('c', 'CC'), ('cpp', 'CXX'), ('objc', 'OBJC'), ('objcpp', 'OBJCXX'):
+        exelist = host.get(language, {}).get('exelist')
+        if not exelist:
+            continue
+        program = os.path.basename(exelist[0]).lower()
+        if program in {tool, f'{tool}.exe'}:
+            continue
+        if program in {'ccache', 'ccache.exe', 'sccache', 'sccache.exe'}:
+            exelist = exelist[1:]
+        args = [tool, *exelist]
+        env[name] = subprocess.list2cmdline(args) if sys.platform == 'win32' else ' '.join(shlex.quote(x) for x in args)
+    return env
+
+
 def _env_ninja_command(*, version: str = _NINJA_REQUIRED_VERSION) -> Optional[str]:
     """Returns the path to ninja, or None if no ninja found."""
     required_version = _parse_version_string(version)
@@ -1020,7 +2019,7 @@ def _env_ninja_command(*, version: str = _NINJA_REQUIRED_VERSION) -> Optional[st
     for ninja in ninja_candidates:
         ninja_path = shutil.which(ninja)
         if ninja_path is not None:
-            version = subprocess.run([ninja_path, '--version'], check=False, text=True, capture_output=True).stdout
+            version = _run_probe([ninja_path, '--version']).stdout
             if _parse_version_string(version) >= required_version:
                 return ninja_path
     return None
@@ -1088,6 +2087,25 @@ def build_sdist(
         return project.sdist(out).name
 
 
+# Build directory used by prepare_metadata_for_build_wheel(), relative
+# to the metadata directory, when no build directory is specified.
+_METADATA_BUILD_DIR = '.mesonpy-build'
+
+
+@_pyproject_hook
+def prepare_metadata_for_build_wheel(
+    metadata_directory: str,
+    config_settings: Optional[Dict[Any, Any]] = None,
+) -> str:
+
+    # The project is configured but not built. The build directory is
+    # placed in the metadata directory, which the frontend removes when
+    # it is done with it, for build_wheel() to reuse it.
+    out = pathlib.Path(metadata_directory)
+    with _project(config_settings, out / _METADATA_BUILD_DIR) as project:
+        return project.metadata(out).name
+
+
 @_pyproject_hook
 def build_wheel(
     wheel_directory: str, config_settings:
@@ -1095,8 +2113,15 @@ def build_wheel(
     metadata_directory: Optional[str] = None,
 ) -> str:
 
+    # Reuse the build directory configured by prepare_metadata_for_build_wheel(), if any.
+    build_dir = None
+    if metadata_directory is not None:
+        build_dir = pathlib.Path(metadata_directory).parent / _METADATA_BUILD_DIR
+        if not build_dir.is_dir():
+            build_dir = None
+
     out = pathlib.Path(wheel_directory)
-    with _project(config_settings) as project:
+    with _project(config_settings, build_dir) as project:
         return project.wheel(out).name
 
 
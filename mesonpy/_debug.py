@@ -0,0 +1,161 @@
+# SPDX-FileCopyrightText: 2026 The meson-python developers
+#
+# SPDX-License-Identifier: MIT
+
+from __future__ import annotations
+
+import mmap
+import os
+import struct
+import subprocess
+import sys
+import typing
+
+
+if typing.TYPE_CHECKING:
+    import pathlib
+
+    from typing import Dict, Iterator, List, Optional, Tuple, Union
+
+    Buffer = Union[bytes, mmap.mmap]
+
+
+def _cstring(data: Buffer, offset: int) -> str:
+    end = data.find(b'\0', offset)
+    if end < 0:
+        raise ValueError('unterminated string')
+    return bytes(data[offset:end]).decode()
+
+
+def _elf_sections(data: Buffer) -> Dict[str, Tuple[int, int]]:
+    """Find the offset and size of the sections of an ELF file, by name."""
+    if data[:4] != b'\x7fELF':
+        raise ValueError('not an ELF file')
+    elfclass = data[4]
+    order = {1: '<', 2: '>'}[data[5]]
+    if elfclass == 2:
+        shoff, = struct.unpack_from(order + 'Q', data, 40)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + 'HHH', data, 58)
+        shdr = order + 'IIQQQQIIQQ'
+    else:
+        shoff, = struct.unpack_from(order + 'I', data, 32)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + 'HHH', data, 46)
+        shdr = order + 'IIIIIIIIII'
+
+    headers = [struct.unpack_from(shdr, data, shoff + i * shentsize) for i in range(shnum)]
+    if not headers:
+        return {}
+    strtab = headers[shstrndx][4]
+    return {_cstring(data, strtab + h[0]): (h[4], h[5]) for h in headers}
+
+
+_NT_GNU_BUILD_ID = 3
+
+
+def _elf_build_id(data: Buffer, sections: Dict[str, Tuple[int, int]]) -> Optional[str]:
+    """Return the GNU build-id of an ELF file, if any, as an hex string."""
+    section = sections.get('.note.gnu.build-id')
+    if section is None:
+        return None
+    offset, size = section
+    order = {1: '<', 2: '>'}[data[5]]
+    end = offset + size
+    while offset + 12 <= end:
+        namesz, descsz, type_ = struct.unpack_from(order + 'III', data, offset)
+        name = offset + 12
+        desc = name + (namesz + 3) // 4 * 4
+        if bytes(data[name:name + namesz]) == b'GNU\0' and type_ == _NT_GNU_BUILD_ID:
+            return bytes(data[desc:desc + descsz]).hex()
+        offset = desc + (descsz + 3) // 4 * 4
+    return None
+
+
+_LC_UUID = 0x1b
+_LC_CODE_SIGNATURE = 0x1d
+
+
+def _macho_commands(data: Buffer) -> Iterator[Tuple[str, int, int]]:
+    """Iterate over the load commands of a Mach-O file, possibly universal."""
+    magic = bytes(data[:4])
+    if magic in {b'\xca\xfe\xba\xbe', b'\xca\xfe\xba\xbf'}:
+        # Universal binary: a big endian header describes the slices.
+        arch = '>IIQQII' if magic == b'\xca\xfe\xba\xbf' else '>IIIII'
+        nfat, = struct.unpack_from('>I', data, 4)
+        slices = [struct.unpack_from(arch, data, 8 + i * struct.calcsize(arch))[2] for i in range(nfat)]
+    else:
+        slices = [0]
+    for base in slices:
+        order, headersize = {
+            b'\xfe\xed\xfa\xce': ('>', 28),
+            b'\xce\xfa\xed\xfe': ('<', 28),
+            b'\xfe\xed\xfa\xcf': ('>', 32),
+            b'\xcf\xfa\xed\xfe': ('<', 32),
+        }[bytes(data[base:base + 4])]
+        ncmds, _ = struct.unpack_from(order + 'II', data, base + 16)
+        pos = base + headersize
+        for _ in range(ncmds):
+            cmd, cmdsize = struct.unpack_from(order + 'II', data, pos)
+            yield order, cmd, pos
+            pos += cmdsize
+
+
+def _read(filepath: pathlib.Path) -> Tuple[Optional[str], bool, bool]:
+    """Return the build identifier of a native file, whether it has debug information, and whether it is signed."""
+    with open(filepath, 'rb') as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as data:
+        if sys.platform == 'darwin':
+            uuid = None
+            signed = False
+            for _, cmd, pos in _macho_commands(data):
+                if cmd == _LC_UUID and uuid is None:
+                    uuid = bytes(data[pos + 8:pos + 24]).hex().upper()
+                elif cmd == _LC_CODE_SIGNATURE:
+                    signed = True
+            # The debug information is collected from the object files.
+            return uuid, True, signed
+        sections = _elf_sections(data)
+        debug = any(name.startswith(('.debug_', '.zdebug_')) for name in sections)
+        return _elf_build_id(data, sections), debug, False
+
+
+def _run(cmd: List[str]) -> None:
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+
+
+def split_debug(filepath: pathlib.Path, arcname: str, debugdir: pathlib.Path) -> List[Tuple[pathlib.Path, str]]:
+    """Strip the debug information from a native file, modifying it in place.
+
+    The debug information is written to files in ``debugdir``. Returns
+    these files and the names under which they are to be archived, keyed
+    by the build-id of ELF files or the UUID of Mach-O files, if present,
+    and by the file archive member name otherwise.
+    """
+    try:
+        build_id, debug, signed = _read(filepath)
+    except (ValueError, KeyError, IndexError, UnicodeDecodeError, struct.error):
+        return []
+    if not debug:
+        return []
+
+    if sys.platform == 'darwin':
+        key = build_id or arcname
+        bundle = debugdir.joinpath(key, f'{filepath.name}.dSYM')
+        bundle.parent.mkdir(parents=True, exist_ok=True)
+        _run(['dsymutil', os.fspath(filepath), '-o', os.fspath(bundle)])
+        _run(['strip', '-S', os.fspath(filepath)])
+        if signed:
+            # Stripping the file invalidates the code signature.
+            _run(['codesign', '--force', '--sign', '-', os.fspath(filepath)])
+        files = sorted(path for path in bundle.rglob('*') if path.is_file())
+        return [(path, path.relative_to(debugdir).as_posix()) for path in files]
+
+    # Follow the layout of the debug files directory searched by GDB.
+    if build_id is not None:
+        name = f'.build-id/{build_id[:2]}/{build_id[2:]}.debug'
+    else:
+        name = f'{arcname}.debug'
+    debugfile = debugdir.joinpath(name)
+    debugfile.parent.mkdir(parents=True, exist_ok=True)
+    objcopy = os.environ.get('OBJCOPY', 'objcopy')
+    _run([objcopy, '--only-keep-debug', os.fspath(filepath), os.fspath(debugfile)])
+    _run([objcopy, '--strip-debug', f'--add-gnu-debuglink={os.fspath(debugfile)}', os.fspath(filepath)])
+    return [(debugfile, name)]
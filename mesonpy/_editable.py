@@ -7,7 +7,7 @@
 from __future__ import annotations
 
 import ast
-import functools
+import contextlib
 import importlib.abc
 import importlib.machinery
 import importlib.util
@@ -15,8 +15,12 @@ import inspect
 import json
 import os
 import pathlib
+import struct
 import subprocess
 import sys
+import tempfile
+import threading
+import time
 import typing
 
 
@@ -28,6 +32,8 @@ if typing.TYPE_CHECKING:
     from typing_extensions import Buffer
 
     NodeBase = Dict[str, Union['Node', str]]
+    # module table, tree, and module listings of the packages
+    Modules = Tuple[Dict[str, Any], 'Node', Dict[str, List[Tuple[str, bool]]]]
     PathStr = Union[str, os.PathLike[str]]
 else:
     NodeBase = dict
@@ -46,6 +52,8 @@ else:
 
 MARKER = 'MESONPY_EDITABLE_SKIP'
 VERBOSE = 'MESONPY_EDITABLE_VERBOSE'
+WATCH = 'MESONPY_EDITABLE_WATCH'
+RECHECK = 'MESONPY_EDITABLE_RECHECK'
 
 
 class MesonpyOrphan(Traversable):
@@ -223,24 +231,50 @@ class Node(NodeBase):
         return dict.get(node, key)
 
 
-def walk(src: str, exclude_files: Set[str], exclude_dirs: Set[str]) -> Iterator[str]:
-    for root, dirnames, filenames in os.walk(src):
-        for name in dirnames.copy():
-            dirsrc = os.path.join(root, name)
-            relpath = os.path.relpath(dirsrc, src)
-            if relpath in exclude_dirs:
-                dirnames.remove(name)
-            # sort to process directories determninistically
-            dirnames.sort()
-        for name in sorted(filenames):
-            filesrc = os.path.join(root, name)
-            relpath = os.path.relpath(filesrc, src)
-            if relpath in exclude_files:
-                continue
-            yield relpath
-
-
-def collect(install_plan: Dict[str, Dict[str, Any]]) -> Node:
+def walk(
+        src: str,
+        exclude_files: Set[str],
+        exclude_dirs: Set[str],
+        visited: Optional[Dict[str, int]] = None,
+) -> Iterator[Tuple[str, os.DirEntry[str]]]:
+    """Enumerate the files in a directory tree.
+
+    Yield the paths relative to ``src`` and the directory entries of the
+    files in the tree, except the excluded ones, in the same order as a
+    top-down :func:`os.walk` with sorted entries. The directory entries
+    cache the file status, which can thus be obtained without further
+    system calls on most platforms. Excluded directories are not visited.
+    When ``visited`` is given, the modification time of the visited
+    directories is recorded in it, before their content is enumerated.
+    """
+    stack = [('', src)]
+    while stack:
+        prefix, path = stack.pop()
+        try:
+            if visited is not None:
+                visited[path] = os.stat(path).st_mtime_ns
+            with os.scandir(path) as it:
+                entries = sorted(it, key=lambda entry: entry.name)
+        except OSError:
+            continue
+        dirs = []
+        for entry in entries:
+            relpath = prefix + entry.name
+            try:
+                is_dir = entry.is_dir()
+            except OSError:
+                is_dir = False
+            if is_dir:
+                # Like os.walk(), do not follow symbolic links to directories.
+                if relpath not in exclude_dirs and not entry.is_symlink():
+                    dirs.append((relpath + os.sep, entry.path))
+            elif relpath not in exclude_files:
+                yield relpath, entry
+        # visit the subdirectories in sorted order
+        stack.extend(reversed(dirs))
+
+
+def collect(install_plan: Dict[str, Dict[str, Any]], visited: Optional[Dict[str, int]] = None) -> Node:
     tree = Node()
     for key, data in install_plan.items():
         for src, target in data.items():
@@ -249,12 +283,81 @@ def collect(install_plan: Dict[str, Dict[str, Any]]) -> Node:
                 if key == 'install_subdirs' or key == 'targets' and os.path.isdir(src):
                     exclude_files = {os.path.normpath(x) for x in target.get('exclude_files', [])}
                     exclude_dirs = {os.path.normpath(x) for x in target.get('exclude_dirs', [])}
-                    for entry in walk(src, exclude_files, exclude_dirs):
-                        tree[(*path.parts[1:], *entry.split(os.sep))] = os.path.join(src, entry)
+                    for relpath, entry in walk(src, exclude_files, exclude_dirs, visited):
+                        tree[(*path.parts[1:], *relpath.split(os.sep))] = entry.path
                 else:
                     tree[path.parts[1:]] = src
     return tree
 
+
+def module_table(tree: Node) -> Dict[str, Tuple[Optional[int], Optional[str], bool]]:
+    """Flatten the tree into a table indexed by fully qualified module name.
+
+    The entries hold the index in :data:`LOADERS` of the loader to use,
+    the path of the file to load, and whether the module is a package,
+    resolved in the same order as :func:`find_spec`. Namespace packages
+    have no loader and no path.
+    """
+    table: Dict[str, Tuple[Optional[int], Optional[str], bool]] = {}
+
+    def visit(prefix: str, node: Node) -> None:
+        modules = {}
+        for index, (_, suffix) in enumerate(LOADERS):
+            for name, value in node.items():
+                if isinstance(value, str) and name.endswith(suffix):
+                    modname = name[:-len(suffix)]
+                    if modname and '.' not in modname:
+                        modules.setdefault(prefix + modname, (index, value, False))
+        for name, value in node.items():
+            if isinstance(value, dict) and '.' not in name:
+                fullname = prefix + name
+                for index, (_, suffix) in enumerate(LOADERS):
+                    src = value.get('__init__' + suffix)
+                    if isinstance(src, str):
+                        table[fullname] = (index, src, True)
+                        break
+                else:
+                    if fullname not in modules:
+                        table[fullname] = (None, None, True)
+                visit(fullname + '.', value)
+        for fullname, entry in modules.items():
+            table.setdefault(fullname, entry)
+
+    visit('', tree)
+    return table
+
+
+def module_listing(node: Node) -> List[Tuple[str, bool]]:
+    """List the modules in a package, as :func:`pkgutil.iter_modules` expects.
+
+    The entries hold the module names and whether each module is a package.
+    """
+    listing = []
+    yielded = set()
+    for name, value in node.items():
+        modname = inspect.getmodulename(name)
+        if modname == '__init__' or modname in yielded:
+            continue
+        if isinstance(value, dict):
+            for _, suffix in LOADERS:
+                if isinstance(value.get('__init__' + suffix), str):
+                    yielded.add(name)
+                    listing.append((name, True))
+                    break
+        elif modname and '.' not in modname:
+            yielded.add(modname)
+            listing.append((modname, False))
+    return listing
+
+
+def _as_node(data: Dict[str, Any]) -> Node:
+    # Convert a tree loaded from its JSON serialization.
+    node = Node()
+    for key, value in data.items():
+        dict.__setitem__(node, key, _as_node(value) if isinstance(value, dict) else value)
+    return node
+
+
 def find_spec(fullname: str, tree: Node) -> Optional[importlib.machinery.ModuleSpec]:
     namespace = False
     parts = fullname.split('.')
@@ -277,14 +380,250 @@ def find_spec(fullname: str, tree: Node) -> Optional[importlib.machinery.ModuleS
 
     # namespace
     if namespace:
-        spec = importlib.machinery.ModuleSpec(fullname, None, is_package=True)
-        assert isinstance(spec.submodule_search_locations, list)  # make mypy happy
-        spec.submodule_search_locations.append(os.path.join(__file__, fullname))
-        return spec
+        return namespace_spec(fullname)
 
     return None
 
 
+def namespace_spec(fullname: str) -> importlib.machinery.ModuleSpec:
+    spec = importlib.machinery.ModuleSpec(fullname, None, is_package=True)
+    assert isinstance(spec.submodule_search_locations, list)  # make mypy happy
+    spec.submodule_search_locations.append(os.path.join(__file__, fullname))
+    return spec
+
+
+STATE_FILE = 'meson-python-editable-state.json'
+MODULES_FILE = 'meson-python-editable-modules.json'
+LOCK_FILE = 'meson-python-editable.lock'
+GENERATION_FILE = 'meson-python-editable-generation'
+
+
+@contextlib.contextmanager
+def build_lock(path: str) -> Iterator[None]:
+    """Hold an exclusive lock on the build directory.
+
+    The lock serializes the builds started by the editable loader from
+    several threads or processes, and with the builds of meson-python
+    using the same build directory.
+    """
+    try:
+        f = open(os.path.join(path, LOCK_FILE), 'a+b')
+    except OSError:
+        # the lock cannot be created in a read-only build directory
+        yield
+        return
+    with f:
+        if sys.platform == 'win32':
+            import msvcrt
+            # the locked region is relative to the current position
+            f.seek(0)
+            while True:
+                try:
+                    # this gives up after trying for about 10 seconds,
+                    # keep trying until the lock is acquired
+                    msvcrt.locking(f.fileno(), msvcrt.LK_LOCK, 1)
+                    break
+                except OSError:
+                    pass
+            try:
+                yield
+            finally:
+                f.seek(0)
+                msvcrt.locking(f.fileno(), msvcrt.LK_UNLCK, 1)
+        else:
+            import fcntl
+            fcntl.flock(f.fileno(), fcntl.LOCK_EX)
+            try:
+                yield
+            finally:
+                fcntl.flock(f.fileno(), fcntl.LOCK_UN)
+
+
+def _ninja_split(line: str) -> Optional[List[str]]:
+    # Split a build statement into words, taking care of the escapes.
+    # The ':' separating outputs from the rule is returned as a word.
+    if '$' not in line:
+        outputs, colon, rest = line.partition(':')
+        return [*outputs.split(), colon, *rest.split()] if colon else outputs.split()
+    words: List[str] = []
+    word: List[str] = []
+    chars = iter(line)
+    for c in chars:
+        if c == '$':
+            c = next(chars, '')
+            if c not in {' ', ':', '$'}:
+                # variable references are not supported
+                return None
+            word.append(c)
+        elif c in {' ', ':'}:
+            if word:
+                words.append(''.join(word))
+                word = []
+            if c == ':':
+                words.append(c)
+        else:
+            word.append(c)
+    if word:
+        words.append(''.join(word))
+    return words
+
+
+def ninja_manifest(path: str) -> Optional[Tuple[Dict[str, Tuple[str, List[str]]], List[str]]]:
+    """Parse the build statements of a ninja build file.
+
+    Return the rule and the inputs of the build statements indexed by
+    output, and the default targets. Return None if the file uses
+    features that are not supported.
+    """
+    edges: Dict[str, Tuple[str, List[str]]] = {}
+    defaults: List[str] = []
+    with open(path, encoding='utf-8') as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        # join continuation lines
+        while line.endswith('$') and (len(line) - len(line.rstrip('$'))) % 2:
+            line = line[:-1] + next(lines, '').lstrip()
+        if line.startswith(('include ', 'subninja ')):
+            return None
+        if line.startswith('default '):
+            words = _ninja_split(line[8:])
+            if words is None:
+                return None
+            defaults.extend(words)
+        elif line.startswith('build '):
+            words = _ninja_split(line[6:])
+            if words is None or ':' not in words:
+                return None
+            sep = words.index(':')
+            outputs = [w for w in words[:sep] if w != '|']
+            rule, inputs = words[sep + 1], [w for w in words[sep + 2:] if w not in {'|', '||', '|@'}]
+            for output in outputs:
+                edges[output] = (rule, inputs)
+    return edges, defaults
+
+
+def ninja_deps(path: str) -> Optional[Dict[str, List[str]]]:
+    """Parse the dependencies recorded by ninja in its deps log.
+
+    Return None if the file format is not supported.
+    """
+    try:
+        with open(path, 'rb') as f:
+            data = f.read()
+    except FileNotFoundError:
+        return {}
+    signature = b'# ninjadeps\n'
+    if not data.startswith(signature):
+        return None
+    version, = struct.unpack_from('=i', data, len(signature))
+    if version not in {3, 4}:
+        return None
+    header = 12 if version == 4 else 8
+    paths: List[str] = []
+    deps: Dict[str, List[str]] = {}
+    pos = len(signature) + 4
+    try:
+        while pos + 4 <= len(data):
+            size, = struct.unpack_from('=I', data, pos)
+            pos += 4
+            is_deps, size = size & 0x80000000, size & 0x7fffffff
+            record = data[pos:pos + size]
+            pos += size
+            if len(record) < size:
+                # truncated record, ninja ignores it too
+                break
+            if is_deps:
+                out, = struct.unpack_from('=i', record)
+                ids = struct.unpack_from(f'={(size - header) // 4}i', record, header)
+                deps[paths[out]] = [paths[i] for i in ids]
+            else:
+                checksum, = struct.unpack_from('=I', record, size - 4)
+                if checksum != ~len(paths) & 0xffffffff:
+                    break
+                paths.append(os.fsdecode(record[:-4].rstrip(b'\0')))
+    except (struct.error, IndexError):
+        return None
+    return deps
+
+
+def _ninja_targets(cmd: List[str]) -> Optional[List[str]]:
+    # Extract the targets from the arguments of the build command.
+    if cmd[1:2] == ['compile']:
+        # On Windows the build command is 'meson compile' eventually with a --ninja-args= option.
+        args = ast.literal_eval(cmd[-1].split('=', 1)[1]) if cmd[-1].startswith('--ninja-args=') else []
+    else:
+        args = cmd[1:]
+    targets = []
+    args = iter(args)
+    for arg in args:
+        if arg in {'-j', '-k', '-l'}:
+            next(args, None)
+        elif arg.startswith(('-j', '-k', '-l')) or arg in {'-v', '--verbose', '--quiet'}:
+            pass
+        elif arg.startswith('-'):
+            return None
+        else:
+            targets.append(arg)
+    return targets
+
+
+def build_inputs(build_path: str, cmd: List[str]) -> Optional[Tuple[List[str], List[str]]]:
+    """Return the files whose changes may require running the build command.
+
+    Return the sources and the outputs of the build. Return None if
+    these cannot be determined or if the build command always has work
+    to do.
+    """
+    targets = _ninja_targets(cmd)
+    manifest = ninja_manifest(os.path.join(build_path, 'build.ninja'))
+    deps = ninja_deps(os.path.join(build_path, '.ninja_deps'))
+    if targets is None or manifest is None or deps is None:
+        return None
+    edges, defaults = manifest
+    # ninja first brings the build file itself up to date
+    roots = ['build.ninja', *(targets or defaults or edges)]
+    sources = set()
+    outputs = set()
+    seen = set()
+    while roots:
+        path = roots.pop()
+        if path in seen:
+            continue
+        seen.add(path)
+        edge = edges.get(path)
+        if edge is None:
+            sources.add(path)
+            continue
+        rule, inputs = edge
+        if rule == 'phony':
+            if not inputs and not os.path.exists(os.path.join(build_path, path)):
+                # phony targets without inputs are always out of date
+                return None
+        else:
+            outputs.add(path)
+            roots.extend(deps.get(path, ()))
+        roots.extend(inputs)
+    return sorted(sources), sorted(outputs)
+
+
+def _seconds(value: str, default: float) -> Optional[float]:
+    # Parse a time interval from an environment variable value.
+    if not value:
+        return None
+    try:
+        return float(value)
+    except ValueError:
+        return default
+
+
+def _fingerprint(path: str) -> Optional[Tuple[int, int]]:
+    try:
+        st = os.stat(path)
+    except OSError:
+        return None
+    return st.st_mtime_ns, st.st_size
+
+
 class MesonpyMetaFinder(importlib.abc.MetaPathFinder):
     def __init__(self, package: str, names: Set[str], path: str, cmd: List[str], verbose: bool = False):
         self._name = package
@@ -293,6 +632,19 @@ class MesonpyMetaFinder(importlib.abc.MetaPathFinder):
         self._build_cmd = cmd
         self._verbose = verbose
         self._loaders: List[Tuple[type, str]] = []
+        self._watcher: Optional[threading.Thread] = None
+        self._stop = threading.Event()
+        # When an interval is set, the build is checked again on module
+        # reload and at most once per interval on import. Otherwise, it
+        # is checked only once per interpreter.
+        self._recheck = _seconds(os.environ.get(RECHECK, ''), 0.0)
+        self._current: Optional[Modules] = None
+        self._next_check = 0.0
+        self._imported: Dict[str, Tuple[str, Optional[Tuple[int, int]]]] = {}
+        # Serializes the builds and the updates of the module table.
+        # Imports from several threads, running in parallel without the
+        # global interpreter lock, wait for the build in progress.
+        self._lock = threading.RLock()
 
     def __repr__(self) -> str:
         return f'{self.__class__.__name__}({self._name!r}, {self._build_path!r})'
@@ -307,8 +659,45 @@ class MesonpyMetaFinder(importlib.abc.MetaPathFinder):
             return None
         if self._build_path in os.environ.get(MARKER, '').split(os.pathsep):
             return None
-        tree = self._rebuild()
-        return find_spec(fullname, tree)
+        modules, tree, _ = self._modules(reload=fullname if target is not None else None)
+        entry = modules.get(fullname)
+        if entry is None:
+            return None
+        index, src, package = entry
+        if index is None:
+            return namespace_spec(fullname)
+        if package:
+            # the loader of a package needs its subtree to access resources
+            for name in fullname.split('.'):
+                tree = typing.cast(Node, tree[name])
+        if self._recheck is not None:
+            self._imported[fullname] = (src, _fingerprint(src))
+        return build_module_spec(LOADERS[index][0], fullname, src, tree if package else None)
+
+    def _modules(self, reload: Optional[str] = None) -> Modules:
+        if self._recheck is None:
+            return self._rebuild()
+        current = self._current
+        if current is not None and reload is None and not (0 < self._recheck and self._next_check <= time.monotonic()):
+            return current
+        with self._lock:
+            latest = self._current
+            if latest is not None and latest is not current and reload is None:
+                # updated by another thread while waiting for the lock
+                return latest
+            self._current = self._update()
+            self._next_check = time.monotonic() + self._recheck
+            # the module being reloaded is not reported
+            stale = [name for name in self.stale_modules() if name != reload]
+            if stale:
+                print(f'meson-python: {self._name}: modules changed since they were imported: {", ".join(stale)}',
+                      file=sys.stderr, flush=True)
+            return self._current
+
+    def stale_modules(self) -> List[str]:
+        """Return the imported modules whose files changed since they were imported."""
+        return sorted(name for name, (src, fingerprint) in list(self._imported.items())
+                      if name in sys.modules and _fingerprint(src) != fingerprint)
 
     def _work_to_do(self, env: dict[str, str]) -> bool:
         if sys.platform == 'win32':
@@ -325,63 +714,233 @@ class MesonpyMetaFinder(importlib.abc.MetaPathFinder):
         p = subprocess.run(dry_run_build_cmd, cwd=self._build_path, env=env, capture_output=True)
         return b'ninja: no work to do.' not in p.stdout and b'samu: nothing to do' not in p.stdout
 
-    @functools.lru_cache(maxsize=1)
-    def _rebuild(self) -> Node:
-        # skip editable wheel lookup during rebuild: during the build
-        # the module we are rebuilding might be imported causing a
-        # rebuild loop.
-        env = os.environ.copy()
-        env[MARKER] = os.pathsep.join((env.get(MARKER, ''), self._build_path))
-
-        if self._verbose or bool(env.get(VERBOSE, '')):
-            # We want to show some output only if there is some work to do
-            if self._work_to_do(env):
-                build_command = ' '.join(self._build_cmd)
-                print(f'meson-python: building {self._name}: {build_command}', flush=True)
-                subprocess.run(self._build_cmd, cwd=self._build_path, env=env)
-        else:
-            subprocess.run(self._build_cmd, cwd=self._build_path, env=env, stdout=subprocess.DEVNULL)
+    def _up_to_date(self) -> bool:
+        # The state recorded after the last successful build lists the
+        # build inputs and outputs and their modification times. When
+        # none changed, running the build command is not necessary.
+        try:
+            with open(os.path.join(self._build_path, STATE_FILE), encoding='utf-8') as f:
+                state = json.load(f)
+            if state['command'] != self._build_cmd:
+                return False
+            for path, mtime in state['files'].items():
+                try:
+                    if os.stat(os.path.join(self._build_path, path)).st_mtime_ns != mtime:
+                        return False
+                except FileNotFoundError:
+                    if mtime is not None:
+                        return False
+            return True
+        except (OSError, ValueError, KeyError, TypeError, AttributeError):
+            return False
+
+    def _record_state(self, start: int) -> None:
+        files = build_inputs(self._build_path, self._build_cmd)
+        if files is None:
+            return
+        sources, outputs = files
+        mtimes: Dict[str, Optional[int]] = {}
+        for path in sources + outputs:
+            try:
+                mtimes[path] = os.stat(os.path.join(self._build_path, path)).st_mtime_ns
+            except FileNotFoundError:
+                mtimes[path] = None
+        # Sources modified while the build was running may not have been
+        # picked up. Do not record the state, to have the build command
+        # examine them on the next import. Allow for the granularity of
+        # the file system timestamps.
+        if any((mtimes[path] or 0) >= start - 2_000_000_000 for path in sources):
+            return
+        state = {'command': self._build_cmd, 'files': mtimes}
+        with tempfile.NamedTemporaryFile('w', dir=self._build_path, delete=False, encoding='utf-8') as f:
+            json.dump(state, f)
+        os.replace(f.name, os.path.join(self._build_path, STATE_FILE))
+
+    def _load_modules(self) -> Optional[Modules]:
+        # The module table is valid as long as the install plan and the
+        # content of the directories walked to build it are unchanged.
+        try:
+            with open(os.path.join(self._build_path, MODULES_FILE), encoding='utf-8') as f:
+                data = json.load(f)
+            if data['loaders'] != [[cls.__name__, suffix] for cls, suffix in LOADERS]:
+                return None
+            st = os.stat(os.path.join(self._build_path, 'meson-info', 'intro-install_plan.json'))
+            if data['plan'] != [st.st_size, st.st_mtime_ns]:
+                return None
+            for path, mtime in data['dirs'].items():
+                if os.stat(path).st_mtime_ns != mtime:
+                    return None
+            return data['modules'], data['tree'], data['listings']
+        except (OSError, ValueError, KeyError, TypeError, AttributeError):
+            return None
 
+    def _collect_modules(self, record: bool) -> Modules:
         install_plan_path = os.path.join(self._build_path, 'meson-info', 'intro-install_plan.json')
+        st = os.stat(install_plan_path)
         with open(install_plan_path, 'r', encoding='utf8') as f:
             install_plan = json.load(f)
-        return collect(install_plan)
+        dirs: Dict[str, int] = {}
+        tree = collect(install_plan, dirs)
+        modules = module_table(tree)
+        listings = {}
+        for name, (_, _, package) in modules.items():
+            if package:
+                node = tree
+                for part in name.split('.'):
+                    node = typing.cast(Node, node[part])
+                listings[name] = module_listing(node)
+        if record:
+            data = {
+                'loaders': [[cls.__name__, suffix] for cls, suffix in LOADERS],
+                'plan': [st.st_size, st.st_mtime_ns],
+                'dirs': dirs,
+                'modules': modules,
+                'tree': tree,
+                'listings': listings,
+            }
+            try:
+                with tempfile.NamedTemporaryFile('w', dir=self._build_path, delete=False, encoding='utf-8') as f:
+                    json.dump(data, f, separators=(',', ':'))
+                os.replace(f.name, os.path.join(self._build_path, MODULES_FILE))
+            except OSError:
+                pass
+        return modules, tree, listings
+
+    def _generation(self) -> Tuple[int, int]:
+        # The generation counter is incremented after each successful
+        # build and recorded with the time the build started, to let the
+        # processes waiting on the lock know that a build started after
+        # they requested one is complete.
+        try:
+            with open(os.path.join(self._build_path, GENERATION_FILE), encoding='utf-8') as f:
+                count, start = f.read().split()
+            return int(count), int(start)
+        except (OSError, ValueError):
+            return 0, 0
+
+    def _build(self) -> Tuple[bool, Optional[Modules]]:
+        # skip editable wheel lookup during rebuild: during the build
+        # the module we are rebuilding might be imported causing a
+        # rebuild loop.
+        env = os.environ.copy()
+        env[MARKER] = os.pathsep.join(x for x in (env.get(MARKER), self._build_path) if x)
+
+        # When a build is already running, wait for it to complete and
+        # use its result instead of running the build command again, if
+        # it started after this build was requested. A build started
+        # earlier may have missed source changes made in the meantime,
+        # unless the recorded state shows that none happened.
+        requested = time.time_ns()
+        with build_lock(self._build_path):
+            count, started = self._generation()
+            if started >= requested or self._up_to_date():
+                return True, None
+            try:
+                os.unlink(os.path.join(self._build_path, STATE_FILE))
+            except FileNotFoundError:
+                pass
+            start = time.time_ns()
+            if self._verbose or bool(env.get(VERBOSE, '')):
+                # We want to show some output only if there is some work to do
+                if self._work_to_do(env):
+                    build_command = ' '.join(self._build_cmd)
+                    print(f'meson-python: building {self._name}: {build_command}', flush=True)
+                    r = subprocess.run(self._build_cmd, cwd=self._build_path, env=env)
+                else:
+                    r = subprocess.CompletedProcess(self._build_cmd, 0)
+            else:
+                r = subprocess.run(self._build_cmd, cwd=self._build_path, env=env, stdout=subprocess.DEVNULL)
+            success = r.returncode == 0
+            modules = None
+            if success:
+                try:
+                    self._record_state(start)
+                except OSError:
+                    pass
+                # Share the module table with the waiting processes.
+                modules = self._load_modules()
+                if modules is None:
+                    modules = self._collect_modules(record=True)
+                try:
+                    with tempfile.NamedTemporaryFile('w', dir=self._build_path, delete=False, encoding='utf-8') as f:
+                        f.write(f'{count + 1} {start}')
+                    os.replace(f.name, os.path.join(self._build_path, GENERATION_FILE))
+                except OSError:
+                    pass
+        return success, modules
+
+    def _watch(self, interval: float) -> None:
+        # Poll the build inputs and rebuild as soon as they change, so
+        # that the build is up to date by the time it is imported, until
+        # stopped.
+        delay = interval
+        while not self._stop.wait(delay):
+            # Without the state recorded after a build, changes can be
+            # detected only running the build command. Stop when the
+            # build inputs cannot be determined, and thus the state
+            # cannot be recorded.
+            if not os.path.exists(os.path.join(self._build_path, STATE_FILE)):
+                if build_inputs(self._build_path, self._build_cmd) is None:
+                    return
+            try:
+                success = self._up_to_date() or self._build()[0]
+            except Exception:
+                success = False
+            # back off while the build keeps failing
+            delay = interval if success else min(delay * 2, max(interval, 60))
+
+    def _rebuild(self) -> Modules:
+        current = self._current
+        if current is None:
+            with self._lock:
+                current = self._current
+                if current is None:
+                    current = self._current = self._update()
+        return current
+
+    def _update(self) -> Modules:
+        success, modules = self._build()
+
+        seconds = _seconds(os.environ.get(WATCH, ''), 1.0)
+        if seconds and seconds > 0 and self._watcher is None:
+            self._watcher = threading.Thread(target=self._watch, args=(seconds,), daemon=True)
+            self._watcher.start()
+
+        # The table of the modules provided by the package is written
+        # after each successful build and reused while still valid.
+        if modules is None:
+            modules = self._load_modules()
+        if modules is None:
+            modules = self._collect_modules(record=success)
+        return modules
 
     def _path_hook(self, path: str) -> MesonpyPathFinder:
         if os.altsep:
             path.replace(os.altsep, os.sep)
         path, _, key = path.rpartition(os.sep)
         if path == __file__:
-            tree = self._rebuild()
-            node = tree.get(tuple(key.split('.')))
-            if isinstance(node, Node):
-                return MesonpyPathFinder(node)
+            _, tree, listings = self._modules()
+            node = tree
+            for name in key.split('.'):
+                node = node.get(name) if isinstance(node, dict) else None  # type: ignore[assignment]
+            if isinstance(node, dict):
+                return MesonpyPathFinder(_as_node(node), listings.get(key))
         raise ImportError
 
 
 class MesonpyPathFinder(importlib.abc.PathEntryFinder):
-    def __init__(self, tree: Node):
+    def __init__(self, tree: Node, listing: Optional[List[Tuple[str, bool]]] = None):
         self._tree = tree
+        self._listing = listing
 
     def find_spec(self, fullname: str, target: Optional[ModuleType] = None) -> Optional[importlib.machinery.ModuleSpec]:
         return find_spec(fullname, self._tree)
 
     def iter_modules(self, prefix: str) -> Iterator[Tuple[str, bool]]:
-        yielded = set()
-        for name, node in self._tree.items():
-            modname = inspect.getmodulename(name)
-            if modname == '__init__' or modname in yielded:
-                continue
-            if isinstance(node, Node):
-                modname = name
-                for _, suffix in LOADERS:
-                    src = node.get('__init__' + suffix)
-                    if isinstance(src, str):
-                        yielded.add(modname)
-                        yield prefix + modname, True
-            elif modname and '.' not in modname:
-                yielded.add(modname)
-                yield prefix + modname, False
+        if self._listing is None:
+            self._listing = module_listing(self._tree)
+        for name, ispkg in self._listing:
+            yield prefix + name, ispkg
 
 
 def install(package: str, names: Set[str], path: str, cmd: List[str], verbose: bool) -> None:
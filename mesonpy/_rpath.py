@@ -4,41 +4,296 @@
 
 from __future__ import annotations
 
+import contextlib
+import mmap
 import os
+import struct
 import subprocess
 import sys
 import typing
 
 
 if typing.TYPE_CHECKING:
-    from typing import List
+    from typing import IO, List, Optional, Tuple, Union
 
     from mesonpy._compat import Iterable, Path
 
+    Buffer = Union[bytes, mmap.mmap]
+
+
+class _Slot(typing.NamedTuple):
+    """Location in a binary file of a string holding an RPATH value."""
+    offset: int
+    size: int
+    value: str
+
+
+def _cstring(data: Buffer, offset: int, end: int) -> str:
+    end = data.find(b'\0', offset, end)
+    if end < 0:
+        raise ValueError('unterminated string')
+    return bytes(data[offset:end]).decode()
+
+
+_PT_LOAD = 1
+_PT_DYNAMIC = 2
+_DT_STRTAB = 5
+_DT_RPATH = 15
+_DT_RUNPATH = 29
+_SHT_STRTAB = 3
+_SHT_DYNAMIC = 6
+_SHT_DYNSYM = 11
+_SHT_GNU_VERDEF = 0x6ffffffd
+_SHT_GNU_VERNEED = 0x6ffffffe
+# Dynamic entries holding an offset in the dynamic string table.
+_DT_STRINGS = frozenset({
+    1,  # DT_NEEDED
+    14,  # DT_SONAME
+    0x6ffffefa,  # DT_CONFIG
+    0x6ffffefb,  # DT_DEPAUDIT
+    0x6ffffefc,  # DT_AUDIT
+    0x7ffffffd,  # DT_AUXILIARY
+    0x7fffffff,  # DT_FILTER
+})
+
+
+def _elf_dynstr_references(data: Buffer, order: str, elfclass: int, strtab: int) -> List[int]:
+    """Find the references to the dynamic string table, other than the RPATH entries.
+
+    The linker merges strings that are the tail of another string, thus
+    the references may point inside the RPATH strings. The references
+    are collected from the sections linked to the string table.
+    Sections of unknown type linked to it cannot be examined.
+    """
+    if elfclass == 2:
+        shoff, = struct.unpack_from(order + 'Q', data, 40)
+        shentsize, shnum = struct.unpack_from(order + 'HH', data, 58)
+        shdr, dyn = order + 'IIQQQQIIQQ', order + 'qQ'
+    else:
+        shoff, = struct.unpack_from(order + 'I', data, 32)
+        shentsize, shnum = struct.unpack_from(order + 'HH', data, 46)
+        shdr, dyn = order + 'IIIIIIIIII', order + 'iI'
+    if not shoff or not shnum:
+        raise ValueError('missing section headers')
+
+    sections = [struct.unpack_from(shdr, data, shoff + i * shentsize) for i in range(shnum)]
+    for index, (_, sh_type, _, _, sh_offset, _, _, _, _, _) in enumerate(sections):
+        if sh_type == _SHT_STRTAB and sh_offset == strtab:
+            break
+    else:
+        raise ValueError('string table section not found')
+
+    references = []
+    for _, sh_type, _, _, offset, size, link, info, _, entsize in sections:
+        if link != index or sh_type == _SHT_STRTAB:
+            continue
+        if sh_type == _SHT_DYNAMIC:
+            for pos in range(offset, offset + size, struct.calcsize(dyn)):
+                tag, value = struct.unpack_from(dyn, data, pos)
+                if tag == 0:
+                    break
+                if tag in _DT_STRINGS:
+                    references.append(value)
+        elif sh_type == _SHT_DYNSYM:
+            for pos in range(offset, offset + size, entsize):
+                references.extend(struct.unpack_from(order + 'I', data, pos))
+        elif sh_type == _SHT_GNU_VERNEED:
+            pos = offset
+            for _ in range(info):
+                _, cnt, file, aux, following = struct.unpack_from(order + 'HHIII', data, pos)
+                references.append(file)
+                auxpos = pos + aux
+                for _ in range(cnt):
+                    _, _, _, name, auxnext = struct.unpack_from(order + 'IHHII', data, auxpos)
+                    references.append(name)
+                    auxpos += auxnext
+                pos += following
+        elif sh_type == _SHT_GNU_VERDEF:
+            pos = offset
+            for _ in range(info):
+                _, _, _, cnt, _, aux, following = struct.unpack_from(order + 'HHHHIII', data, pos)
+                auxpos = pos + aux
+                for _ in range(cnt):
+                    name, auxnext = struct.unpack_from(order + 'II', data, auxpos)
+                    references.append(name)
+                    auxpos += auxnext
+                pos += following
+        else:
+            raise ValueError('unknown section linked to the string table')
+    return references
+
+
+def _elf_rpath_slots(data: Buffer) -> List[_Slot]:
+    """Find the DT_RPATH and DT_RUNPATH strings in an ELF file."""
+    if data[:4] != b'\x7fELF':
+        raise ValueError('not an ELF file')
+    elfclass = data[4]
+    order = {1: '<', 2: '>'}[data[5]]
+    if elfclass == 2:
+        phoff, = struct.unpack_from(order + 'Q', data, 32)
+        phentsize, phnum = struct.unpack_from(order + 'HH', data, 54)
+        phdr, dyn = order + 'IIQQQQQQ', order + 'qQ'
+    else:
+        phoff, = struct.unpack_from(order + 'I', data, 28)
+        phentsize, phnum = struct.unpack_from(order + 'HH', data, 42)
+        phdr, dyn = order + 'IIIIIIII', order + 'iI'
+
+    loads = []
+    dynamic = None
+    for i in range(phnum):
+        fields = struct.unpack_from(phdr, data, phoff + i * phentsize)
+        if elfclass == 2:
+            p_type, _, p_offset, p_vaddr, _, p_filesz, _, _ = fields
+        else:
+            p_type, p_offset, p_vaddr, _, p_filesz, _, _, _ = fields
+        if p_type == _PT_LOAD:
+            loads.append((p_vaddr, p_offset, p_filesz))
+        elif p_type == _PT_DYNAMIC:
+            dynamic = (p_offset, p_filesz)
+    if dynamic is None:
+        return []
+
+    strtab = None
+    entries = []
+    offset, size = dynamic
+    for pos in range(offset, offset + size, struct.calcsize(dyn)):
+        tag, value = struct.unpack_from(dyn, data, pos)
+        if tag == 0:
+            break
+        if tag == _DT_STRTAB:
+            strtab = value
+        elif tag in {_DT_RPATH, _DT_RUNPATH}:
+            entries.append(value)
+    if not entries:
+        return []
+    if strtab is None:
+        raise ValueError('missing string table')
+
+    # The string table is referenced by its virtual address.
+    for vaddr, offset, size in loads:
+        if vaddr <= strtab < vaddr + size:
+            strtab = strtab - vaddr + offset
+            break
+    else:
+        raise ValueError('string table not mapped')
+
+    # The strings are modified in place: no other string may share
+    # their storage.
+    references = _elf_dynstr_references(data, order, elfclass, strtab)
+    slots = []
+    for entry in entries:
+        value = _cstring(data, strtab + entry, len(data))
+        end = entry + len(value)
+        if any(entry <= ref <= end for ref in references) or any(entry < ref <= end for ref in entries):
+            raise ValueError('string table entry shared with other strings')
+        slots.append(_Slot(strtab + entry, len(value), value))
+    return slots
+
+
+_LC_CODE_SIGNATURE = 0x1d
+_LC_RPATH = 0x8000001c
+
+
+def _macho_rpath_slots(data: Buffer) -> Tuple[List[_Slot], bool]:
+    """Find the LC_RPATH strings in a Mach-O file, and whether it is signed."""
+    magic = bytes(data[:4])
+    if magic in {b'\xca\xfe\xba\xbe', b'\xca\xfe\xba\xbf'}:
+        # Universal binary: a big endian header describes the slices.
+        arch = '>IIQQII' if magic == b'\xca\xfe\xba\xbf' else '>IIIII'
+        nfat, = struct.unpack_from('>I', data, 4)
+        slices = []
+        for i in range(nfat):
+            slices.append(struct.unpack_from(arch, data, 8 + i * struct.calcsize(arch))[2])
+    else:
+        slices = [0]
+
+    slots = []
+    signed = False
+    for base in slices:
+        magic = bytes(data[base:base + 4])
+        order, headersize = {
+            b'\xfe\xed\xfa\xce': ('>', 28),
+            b'\xce\xfa\xed\xfe': ('<', 28),
+            b'\xfe\xed\xfa\xcf': ('>', 32),
+            b'\xcf\xfa\xed\xfe': ('<', 32),
+        }[magic]
+        ncmds, _ = struct.unpack_from(order + 'II', data, base + 16)
+        pos = base + headersize
+        for _ in range(ncmds):
+            cmd, cmdsize = struct.unpack_from(order + 'II', data, pos)
+            if cmd == _LC_CODE_SIGNATURE:
+                signed = True
+            elif cmd == _LC_RPATH:
+                offset, = struct.unpack_from(order + 'I', data, pos + 8)
+                value = _cstring(data, pos + offset, pos + cmdsize)
+                # The string is padded with zeros to the command size
+                # and must be zero terminated.
+                slots.append(_Slot(pos + offset, cmdsize - offset - 1, value))
+            pos += cmdsize
+    return slots, signed
+
+
+def _read_slots(file: Union[Path, IO[bytes]]) -> Optional[Tuple[List[_Slot], bool]]:
+    """Locate the RPATH entries in a binary without spawning external tools.
+
+    The binary can be specified as a path or as a file object open for
+    reading. Returns None if the file format is not understood, in
+    which case the external tools should be used instead.
+    """
+    with contextlib.ExitStack() as stack:
+        if isinstance(file, (str, os.PathLike)):
+            file = stack.enter_context(open(file, 'rb'))
+        try:
+            with mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ) as data:
+                if sys.platform == 'darwin':
+                    return _macho_rpath_slots(data)
+                return _elf_rpath_slots(data), False
+        except (ValueError, KeyError, IndexError, UnicodeDecodeError, struct.error):
+            return None
+
 
 if sys.platform == 'linux':
 
-    def _get_rpath(filepath: Path) -> List[str]:
+    def _patchelf_get_rpath(filepath: Path) -> List[str]:
         r = subprocess.run(['patchelf', '--print-rpath', os.fspath(filepath)], capture_output=True, text=True)
         return r.stdout.strip().split(':')
 
+    def _get_rpath(filepath: Path) -> List[str]:
+        info = _read_slots(filepath)
+        if info is None:
+            return _patchelf_get_rpath(filepath)
+        return [path for slot in info[0] for path in slot.value.split(':')]
+
     def _set_rpath(filepath: Path, rpath: Iterable[str]) -> None:
         subprocess.run(['patchelf','--set-rpath', ':'.join(rpath), os.fspath(filepath)], check=True)
 
-    def fix_rpath(filepath: Path, libs_relative_path: str) -> None:
-        old_rpath = _get_rpath(filepath)
+    def _relocate(rpath: List[str], libs_relative_path: str) -> List[str]:
         new_rpath = []
-        for path in old_rpath:
+        for path in rpath:
             if path.startswith('$ORIGIN/'):
                 path = '$ORIGIN/' + libs_relative_path
             new_rpath.append(path)
+        return new_rpath
+
+    def _relocate_slots(slots: List[_Slot], signed: bool, libs_relative_path: str) -> List[Tuple[_Slot, str]]:
+        changes = []
+        for slot in slots:
+            old_rpath = slot.value.split(':')
+            new_rpath = _relocate(old_rpath, libs_relative_path)
+            if new_rpath != old_rpath:
+                changes.append((slot, ':'.join(new_rpath)))
+        return changes
+
+    def _fix_rpath_external(filepath: Path, libs_relative_path: str) -> None:
+        old_rpath = _patchelf_get_rpath(filepath)
+        new_rpath = _relocate(old_rpath, libs_relative_path)
         if new_rpath != old_rpath:
             _set_rpath(filepath, new_rpath)
 
 
 elif sys.platform == 'darwin':
 
-    def _get_rpath(filepath: Path) -> List[str]:
+    def _otool_get_rpath(filepath: Path) -> List[str]:
         rpath = []
         r = subprocess.run(['otool', '-l', os.fspath(filepath)], capture_output=True, text=True)
         rpath_tag = False
@@ -50,15 +305,71 @@ elif sys.platform == 'darwin':
                 rpath_tag = False
         return rpath
 
+    def _get_rpath(filepath: Path) -> List[str]:
+        info = _read_slots(filepath)
+        if info is None:
+            return _otool_get_rpath(filepath)
+        # Universal binaries have a copy of the load commands for each
+        # architecture, report each entry once.
+        return list(dict.fromkeys(slot.value for slot in info[0]))
+
     def _replace_rpath(filepath: Path, old: str, new: str) -> None:
         subprocess.run(['install_name_tool', '-rpath', old, new, os.fspath(filepath)], check=True)
 
-    def fix_rpath(filepath: Path, libs_relative_path: str) -> None:
-        for path in _get_rpath(filepath):
+    def _relocate_slots(slots: List[_Slot], signed: bool, libs_relative_path: str) -> List[Tuple[_Slot, str]]:
+        new = '@loader_path/' + libs_relative_path
+        changes = [(slot, new) for slot in slots if slot.value.startswith('@loader_path/') and slot.value != new]
+        if changes and signed:
+            # Modifying the load commands invalidates the code signature,
+            # which install_name_tool takes care of updating.
+            raise ValueError('code signature')
+        return changes
+
+    def _fix_rpath_external(filepath: Path, libs_relative_path: str) -> None:
+        for path in _otool_get_rpath(filepath):
             if path.startswith('@loader_path/'):
                 _replace_rpath(filepath, path, '@loader_path/' + libs_relative_path)
 
+
+if sys.platform in {'linux', 'darwin'}:
+
+    def rpath_patches(file: Union[Path, IO[bytes]], libs_relative_path: str) -> Optional[List[Tuple[int, bytes]]]:
+        """Compute the modifications required to relocate the RPATH entries.
+
+        The file, specified as a path or as a file object, is not
+        modified. The modifications are returned as a list of offsets
+        and the data to be written at those offsets.
+        If the RPATH entries cannot be modified in place, for example
+        because the new values do not fit in the space taken by the old
+        ones, None is returned and the file needs to be modified with
+        :func:`fix_rpath`.
+        """
+        info = _read_slots(file)
+        if info is None:
+            return None
+        try:
+            changes = _relocate_slots(*info, libs_relative_path)
+        except ValueError:
+            return None
+        if not all(len(value.encode()) <= slot.size for slot, value in changes):
+            return None
+        return [(slot.offset, value.encode().ljust(slot.size, b'\0')) for slot, value in changes]
+
+    def fix_rpath(filepath: Path, libs_relative_path: str) -> None:
+        patches = rpath_patches(filepath, libs_relative_path)
+        if patches is None:
+            _fix_rpath_external(filepath, libs_relative_path)
+            return
+        if patches:
+            with open(filepath, 'r+b') as f:
+                for offset, data in patches:
+                    f.seek(offset)
+                    f.write(data)
+
 else:
 
+    def rpath_patches(file: Union[Path, IO[bytes]], libs_relative_path: str) -> Optional[List[Tuple[int, bytes]]]:
+        raise NotImplementedError(f'Bundling libraries in wheel is not supported on {sys.platform}')
+
     def fix_rpath(filepath: Path, libs_relative_path: str) -> None:
         raise NotImplementedError(f'Bundling libraries in wheel is not supported on {sys.platform}')
@@ -6,17 +6,31 @@
 
 from __future__ import annotations
 
+import collections
+import concurrent.futures
 import contextlib
-import gzip
+import itertools
+import json
 import os
+import struct
+import sys
 import tarfile
+import threading
+import time
 import typing
+import zlib
 
 from typing import IO
 
 
 if typing.TYPE_CHECKING:  # pragma: no cover
-    from mesonpy._compat import Iterator, Path
+    from concurrent.futures import Executor, Future
+    from typing import Any, Callable, Deque, Dict, List, Optional, Set, Tuple, TypeVar
+
+    from mesonpy._compat import Iterable, Iterator, Path
+
+    T = TypeVar('T')
+    R = TypeVar('R')
 
 
 @contextlib.contextmanager
@@ -30,19 +44,159 @@ def chdir(path: Path) -> Iterator[Path]:
         os.chdir(old_cwd)
 
 
+def _deflate(data: bytes, zdict: bytes, level: int, last: bool) -> bytes:
+    if zdict:
+        compressor = zlib.compressobj(level, zlib.DEFLATED, -zlib.MAX_WBITS, zlib.DEF_MEM_LEVEL, 0, zdict)
+    else:
+        compressor = zlib.compressobj(level, zlib.DEFLATED, -zlib.MAX_WBITS)
+    return compressor.compress(data) + compressor.flush(zlib.Z_FINISH if last else zlib.Z_SYNC_FLUSH)
+
+
+class GzipWriter:
+    """Write a gzip file compressing the data in blocks on worker threads.
+
+    Like pigz, the data is split in blocks of fixed size, compressed
+    independently using the end of the preceding block as dictionary, and
+    the compressed blocks are concatenated in a single deflate stream. The
+    output depends only on the data and on the compression level, not on
+    the number of threads. At most two blocks per thread are held in memory.
+    """
+
+    BLOCK_SIZE = 128 * 1024
+    DICT_SIZE = 32 * 1024
+
+    def __init__(self, path: Path, jobs: int = 1, compresslevel: int = 9) -> None:
+        self._file = open(path, 'wb')
+        self._level = compresslevel
+        self._crc = 0
+        self._size = 0
+        self._buffer = bytearray()
+        self._zdict = b''
+        self._jobs = jobs
+        self._executor = concurrent.futures.ThreadPoolExecutor(jobs) if jobs > 1 else None
+        self._pending: Deque[Future[bytes]] = collections.deque()
+
+        # Write the same header as gzip.GzipFile. Set the stream last
+        # modification time to 0.  This mimics what 'git archive' does and
+        # makes the archives byte-for-byte reproducible.
+        name = os.path.basename(path)
+        if name.endswith('.gz'):
+            name = name[:-3]
+        try:
+            fname = name.encode('latin-1')
+        except UnicodeEncodeError:
+            fname = b''
+        xfl = {9: b'\x02', 1: b'\x04'}.get(compresslevel, b'\x00')
+        self._file.write(b'\x1f\x8b\x08' + (b'\x08' if fname else b'\x00') + struct.pack('<L', 0) + xfl + b'\xff')
+        if fname:
+            self._file.write(fname + b'\x00')
+
+    def _submit(self, block: bytes, last: bool) -> None:
+        if self._executor is None:
+            self._file.write(_deflate(block, self._zdict, self._level, last))
+        else:
+            self._pending.append(self._executor.submit(_deflate, block, self._zdict, self._level, last))
+            while len(self._pending) > 2 * self._jobs:
+                self._file.write(self._pending.popleft().result())
+        self._zdict = block[-self.DICT_SIZE:]
+
+    def write(self, data: bytes) -> int:
+        self._crc = zlib.crc32(data, self._crc)
+        self._size += len(data)
+        self._buffer += data
+        while len(self._buffer) >= self.BLOCK_SIZE:
+            block = bytes(self._buffer[:self.BLOCK_SIZE])
+            del self._buffer[:self.BLOCK_SIZE]
+            self._submit(block, False)
+        return len(data)
+
+    def tell(self) -> int:
+        return self._size
+
+    def close(self) -> None:
+        if self._file.closed:
+            return
+        try:
+            self._submit(bytes(self._buffer), True)
+            while self._pending:
+                self._file.write(self._pending.popleft().result())
+            self._file.write(struct.pack('<LL', self._crc, self._size & 0xffffffff))
+        finally:
+            if self._executor is not None:
+                for future in self._pending:
+                    future.cancel()
+                self._executor.shutdown()
+            self._file.close()
+
+
+def _zstd() -> Any:
+    try:
+        from compression import zstd  # type: ignore[import-not-found]
+        return zstd
+    except ImportError:
+        import zstandard  # type: ignore[import-not-found]
+        return zstandard
+
+
+def zstd_available() -> bool:
+    """Whether Zstandard compression is supported."""
+    try:
+        _zstd()
+    except ImportError:
+        return False
+    return True
+
+
+def zstd_writer(path: Path, jobs: int = 1, level: int = 3) -> IO[bytes]:
+    """Write a Zstandard file compressing the data on worker threads.
+
+    The compression module of the Python standard library is used when
+    available, otherwise the zstandard package. The compression always
+    runs in the multi-threaded mode of the library, even with a single
+    worker thread, which makes the output independent of the number of
+    threads.
+    """
+    zstd = _zstd()
+    if zstd.__name__ == 'zstandard':
+        compressor = zstd.ZstdCompressor(level=level, threads=jobs, write_checksum=True)
+        return typing.cast(IO[bytes], compressor.stream_writer(open(path, 'wb')))
+    options = {
+        zstd.CompressionParameter.compression_level: level,
+        zstd.CompressionParameter.nb_workers: jobs,
+        zstd.CompressionParameter.checksum_flag: 1,
+    }
+    return typing.cast(IO[bytes], zstd.ZstdFile(path, 'w', options=options))
+
+
+# Extension of the archives and default compression level of the
+# supported sdist compression methods.
+SDIST_COMPRESSION = {
+    'gzip': ('.tar.gz', 9),
+    'zstd': ('.tar.zst', 3),
+}
+
+
 @contextlib.contextmanager
-def create_targz(path: Path) -> Iterator[tarfile.TarFile]:
-    """Opens a .tar.gz file in the file system for edition.."""
+def create_targz(
+    path: Path,
+    jobs: int = 1,
+    compression: str = 'gzip',
+    level: Optional[int] = None,
+) -> Iterator[tarfile.TarFile]:
+    """Opens a compressed tar file in the file system for edition.
+
+    The archive is compressed with gzip or Zstandard, at the given level
+    or at the default level of the method, using the given number of
+    threads.
+    """
 
     os.makedirs(os.path.dirname(path), exist_ok=True)
-    file = typing.cast(IO[bytes], gzip.GzipFile(
-        path,
-        mode='w',
-        # Set the stream last modification time to 0.  This mimics
-        # what 'git archive' does and makes the archives byte-for-byte
-        # reproducible.
-        mtime=0,
-    ))
+    if level is None:
+        level = SDIST_COMPRESSION[compression][1]
+    if compression == 'zstd':
+        file = zstd_writer(path, jobs, level)
+    else:
+        file = typing.cast(IO[bytes], GzipWriter(path, jobs, level))
     tar = tarfile.TarFile(
         mode='w',
         fileobj=file,
@@ -53,6 +207,211 @@ def create_targz(path: Path) -> Iterator[tarfile.TarFile]:
         yield tar
 
 
+def update_file(path: Path, text: str) -> bool:
+    """Write text to a file, unless the file already has this content.
+
+    Leaving the file alone preserves its modification time, which is
+    relevant for tools that track changes to it. Return whether the file
+    has been written.
+    """
+    data = text.encode('utf-8')
+    try:
+        with open(path, 'rb') as f:
+            if f.read() == data:
+                return False
+    except FileNotFoundError:
+        pass
+    with open(path, 'wb') as f:
+        f.write(data)
+    return True
+
+
+def gil_disabled() -> bool:
+    """Whether the interpreter runs without the global interpreter lock."""
+    return not getattr(sys, '_is_gil_enabled', lambda: True)()
+
+
+def imap(executor: Executor, func: Callable[[T], R], iterable: Iterable[T], window: int) -> Iterator[R]:
+    """Like Executor.map() but with at most window tasks in flight.
+
+    Results are returned in the order of the input items. Submitting
+    tasks only as results are consumed bounds the memory used to hold
+    results that are not consumed yet.
+    """
+    items = iter(iterable)
+    pending: Deque[Future[R]] = collections.deque(
+        executor.submit(func, item) for item in itertools.islice(items, window))
+    try:
+        while pending:
+            result = pending.popleft().result()
+            for item in itertools.islice(items, 1):
+                pending.append(executor.submit(func, item))
+            yield result
+    finally:
+        for future in pending:
+            future.cancel()
+
+
+class Timings:
+    """Record the duration of the build phases.
+
+    Phases are recorded with the arguments describing them, possibly
+    filled in while the phase runs, and with the thread they run on.
+    Recording is safe from worker threads.
+    """
+
+    def __init__(self) -> None:
+        self._origin = time.perf_counter()
+        self.events: List[Dict[str, Any]] = []
+
+    @contextlib.contextmanager
+    def phase(self, name: str, **args: Any) -> Iterator[Dict[str, Any]]:
+        start = time.perf_counter()
+        try:
+            yield args
+        finally:
+            self.events.append({
+                'name': name,
+                'start': start - self._origin,
+                'duration': time.perf_counter() - start,
+                'thread': threading.get_ident(),
+                'args': args,
+            })
+
+    def summary(self) -> Dict[str, Any]:
+        """The recorded phases and the total duration and count of each phase."""
+        totals: Dict[str, Dict[str, Any]] = {}
+        for event in self.events:
+            total = totals.setdefault(event['name'], {'count': 0, 'duration': 0.0})
+            total['count'] += 1
+            total['duration'] += event['duration']
+        return {'events': sorted(self.events, key=lambda x: x['start']), 'totals': totals}
+
+    def trace(self) -> Dict[str, Any]:
+        """The recorded phases in the Chrome trace event format."""
+        threads = {ident: i for i, ident in enumerate(dict.fromkeys(x['thread'] for x in self.events))}
+        events = [{
+            'name': event['name'],
+            'ph': 'X',
+            'ts': round(event['start'] * 1e6),
+            'dur': round(event['duration'] * 1e6),
+            'pid': os.getpid(),
+            'tid': threads[event['thread']],
+            'args': event['args'],
+        } for event in self.events]
+        return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+    def write(self, path: Path, trace: Optional[Path] = None) -> None:
+        with open(path, 'w', encoding='utf-8') as f:
+            json.dump(self.summary(), f, indent=2)
+        if trace is not None:
+            with open(trace, 'w', encoding='utf-8') as f:
+                json.dump(self.trace(), f)
+
+
+def _read_text(path: str) -> Optional[str]:
+    try:
+        with open(path, encoding='utf-8') as f:
+            return f.read().strip()
+    except (OSError, ValueError):
+        return None
+
+
+def _cgroup_dirs(controller: str, root: str = '/') -> Iterator[str]:
+    """Find the directories of the cgroups of the current process, from the innermost.
+
+    Both the cgroup v1 hierarchy for ``controller`` and the unified
+    cgroup v2 hierarchy are considered. The limits of enclosing cgroups
+    apply too, thus the directories of the ancestors are also returned.
+    When running in a container without a cgroup namespace, the path of
+    the cgroup of the process may not exist in the mounted hierarchy and
+    only the existing directories are returned.
+    """
+    mount = os.path.join(root, 'sys', 'fs', 'cgroup')
+    text = _read_text(os.path.join(root, 'proc', 'self', 'cgroup')) or ''
+    seen: Set[str] = set()
+    for line in text.splitlines():
+        number, controllers, path = line.split(':', 2)
+        if number == '0' and not controllers:
+            bases = [mount, os.path.join(mount, 'unified')]
+        elif controller in controllers.split(','):
+            bases = [os.path.join(mount, controllers), os.path.join(mount, controller)]
+        else:
+            continue
+        parts = [x for x in path.split('/') if x]
+        for base in bases:
+            for i in range(len(parts), -1, -1):
+                directory = os.path.join(base, *parts[:i])
+                if directory not in seen and os.path.isdir(directory):
+                    seen.add(directory)
+                    yield directory
+
+
+def cpu_limit(root: str = '/') -> float:
+    """Return the number of CPUs the current process can use.
+
+    This is the number of CPUs in the affinity mask of the process,
+    further limited by the CPU bandwidth quota of its cgroups.
+    """
+    if hasattr(os, 'sched_getaffinity'):
+        cpus = float(len(os.sched_getaffinity(0)))
+    else:
+        cpus = float(os.cpu_count() or 1)
+    for directory in _cgroup_dirs('cpu', root):
+        # cgroup v2
+        value = _read_text(os.path.join(directory, 'cpu.max'))
+        if value is not None:
+            quota, _, period = value.partition(' ')
+            if quota != 'max' and int(quota) > 0 and int(period or 100000) > 0:
+                cpus = min(cpus, int(quota) / int(period or 100000))
+            continue
+        # cgroup v1
+        quota = _read_text(os.path.join(directory, 'cpu.cfs_quota_us'))
+        period = _read_text(os.path.join(directory, 'cpu.cfs_period_us'))
+        if quota is not None and period is not None and int(quota) > 0 and int(period) > 0:
+            cpus = min(cpus, int(quota) / int(period))
+    return max(cpus, 1.0)
+
+
+def memory_limit(root: str = '/') -> Optional[int]:
+    """Return the amount of memory in bytes the current process can use, if known.
+
+    This is the physical memory, further limited by the memory limit of
+    the cgroups of the process.
+    """
+    memory: Optional[int] = None
+    try:
+        memory = os.sysconf('SC_PHYS_PAGES') * os.sysconf('SC_PAGE_SIZE')
+        if memory <= 0:
+            memory = None
+    except (AttributeError, OSError, ValueError):
+        pass
+    for directory in _cgroup_dirs('memory', root):
+        # cgroup v2 and cgroup v1, where no limit is expressed as a huge value
+        for name in 'memory.max', 'memory.limit_in_bytes':
+            value = _read_text(os.path.join(directory, name))
+            if value is not None and value.isdigit() and int(value) < 2 ** 62:
+                memory = int(value) if memory is None else min(memory, int(value))
+    return memory
+
+
+def build_parallelism(job_memory: Optional[int] = None, root: str = '/') -> Tuple[int, float]:
+    """Return the number of parallel build jobs and the maximum load average.
+
+    The number of jobs is the number of usable CPUs, rounded up, limited
+    to the number of jobs that fit in the available memory when each job
+    requires ``job_memory`` bytes. The maximum load average is the number
+    of usable CPUs.
+    """
+    cpus = cpu_limit(root)
+    jobs = max(1, int(-(-cpus // 1)))
+    if job_memory:
+        memory = memory_limit(root)
+        if memory is not None:
+            jobs = max(1, min(jobs, memory // job_memory))
+    return jobs, cpus
+
+
 def setup_windows_console() -> bool:
     from ctypes import byref, windll  # type: ignore
     from ctypes.wintypes import DWORD
@@ -8,22 +8,29 @@ import base64
 import csv
 import hashlib
 import io
+import json
 import os
 import re
 import stat
+import struct
+import threading
 import time
 import typing
 import zipfile
+import zlib
 
 
 if typing.TYPE_CHECKING:  # pragma: no cover
     from types import TracebackType
-    from typing import List, Optional, Tuple, Type, Union
+    from typing import IO, Any, Dict, List, Optional, Tuple, Type, Union
 
-    from mesonpy._compat import Path
+    from mesonpy._compat import Mapping, Path, Sequence
+
+    Readable = Union[IO[bytes], 'PatchedFile']
 
 
 MIN_TIMESTAMP = 315532800  # 1980-01-01 00:00:00 UTC
+CHUNK_SIZE = 1024 * 1024  # read files in chunks to bound memory usage
 WHEEL_FILENAME_REGEX = re.compile(r'^(?P<name>[^-]+)-(?P<version>[^-]+)(:?-(?P<build>[^-]+))?-(?P<tag>[^-]+-[^-]+-[^-]+).whl$')
 
 
@@ -31,12 +38,64 @@ def _b64encode(data: bytes) -> bytes:
     return base64.urlsafe_b64encode(data).rstrip(b'=')
 
 
+def file_digest(filename: Path) -> bytes:
+    """Compute the SHA-256 digest of a file content, reading it in chunks."""
+    with open(filename, 'rb') as f:
+        return fileobj_digest(f)
+
+
+def fileobj_digest(fileobj: Readable) -> bytes:
+    """Compute the SHA-256 digest of a file object content, see :func:`file_digest`."""
+    sha256 = hashlib.sha256()
+    while True:
+        chunk = fileobj.read(CHUNK_SIZE)
+        if not chunk:
+            break
+        sha256.update(chunk)
+    return sha256.digest()
+
+
+class PatchedFile:
+    """File object wrapper that overlays data at given offsets while reading."""
+
+    def __init__(self, fileobj: IO[bytes], patches: Sequence[Tuple[int, bytes]]):
+        self._fileobj = fileobj
+        self._patches = patches
+        self._pos = 0
+
+    def read(self, size: int = -1) -> bytes:
+        data = self._fileobj.read(size)
+        start = self._pos
+        end = self._pos = start + len(data)
+        overlapping = [(offset, patch) for offset, patch in self._patches if offset < end and offset + len(patch) > start]
+        if not overlapping:
+            return data
+        buffer = bytearray(data)
+        for offset, patch in overlapping:
+            lo = max(offset, start)
+            hi = min(offset + len(patch), end)
+            buffer[lo - start:hi - start] = patch[lo - offset:hi - offset]
+        return bytes(buffer)
+
+    def seek(self, offset: int) -> int:
+        self._pos = self._fileobj.seek(offset)
+        return self._pos
+
+
+class CompressedMember(typing.NamedTuple):
+    """Archive member compressed ahead of being added to the archive."""
+    zinfo: zipfile.ZipInfo
+    data: bytes
+    digest: str
+
+
 class WheelFile:
     """Implement the wheel package binary distribution format.
 
     https://packaging.python.org/en/latest/specifications/binary-distribution-format/
     """
-    def __new__(cls, filename: Path, mode: str = 'r', compression: int = zipfile.ZIP_DEFLATED) -> 'WheelFile':
+    def __new__(cls, filename: Path, mode: str = 'r', compression: int = zipfile.ZIP_DEFLATED,
+                compresslevel: Optional[int] = None, methods: Optional[Mapping[str, int]] = None) -> 'WheelFile':
         if mode == 'w':
             return super().__new__(WheelFileWriter)
         raise NotImplementedError
@@ -52,10 +111,38 @@ class WheelFile:
     def hash(data: bytes) -> str:
         return 'sha256=' + _b64encode(hashlib.sha256(data).digest()).decode('ascii')
 
+    @staticmethod
+    def hashfile(fileobj: Readable) -> str:
+        return 'sha256=' + _b64encode(fileobj_digest(fileobj)).decode('ascii')
+
     def writestr(self, zinfo_or_arcname: Union[str, zipfile.ZipInfo], data: bytes) -> None:
         raise NotImplementedError
 
-    def write(self, filename: Path, arcname: Optional[str] = None) -> None:
+    def write(self, filename: Path, arcname: Optional[str] = None, patches: Sequence[Tuple[int, bytes]] = ()) -> None:
+        raise NotImplementedError
+
+    def compress_type(self, arcname: str) -> int:
+        raise NotImplementedError
+
+    def fileinfo(self, arcname: str, st: os.stat_result) -> zipfile.ZipInfo:
+        raise NotImplementedError
+
+    def writefile(self, zinfo: zipfile.ZipInfo, fileobj: Readable, size: int) -> None:
+        raise NotImplementedError
+
+    def compress(self, filename: Path, arcname: str, patches: Sequence[Tuple[int, bytes]] = ()) -> CompressedMember:
+        raise NotImplementedError
+
+    def compressfile(self, zinfo: zipfile.ZipInfo, fileobj: Readable) -> CompressedMember:
+        raise NotImplementedError
+
+    def writecompressed(self, member: CompressedMember) -> None:
+        raise NotImplementedError
+
+    def writecopy(self, zinfo: zipfile.ZipInfo, arcname: str) -> None:
+        raise NotImplementedError
+
+    def digest(self, arcname: str) -> str:
         raise NotImplementedError
 
     def close(self) -> None:
@@ -69,7 +156,8 @@ class WheelFile:
 
 
 class WheelFileWriter(WheelFile):
-    def __init__(self, filepath: Path, mode: str, compression: int = zipfile.ZIP_DEFLATED):
+    def __init__(self, filepath: Path, mode: str, compression: int = zipfile.ZIP_DEFLATED,
+                 compresslevel: Optional[int] = None, methods: Optional[Mapping[str, int]] = None):
         filename = os.path.basename(filepath)
         match = WHEEL_FILENAME_REGEX.match(filename)
         if not match:
@@ -77,7 +165,15 @@ class WheelFileWriter(WheelFile):
         self.name = match.group('name')
         self.version = match.group('version')
         self.entries: List[Tuple[str, str, int]] = []
-        self.archive = zipfile.ZipFile(filepath, mode='w', compression=compression, allowZip64=True)
+        # Content digest of the members added from files.
+        self.digests: Dict[str, str] = {}
+        # Compression method for the files with the given suffixes,
+        # overriding the archive compression method. The longest
+        # matching suffix applies.
+        self.methods = {suffix.lower(): method for suffix, method in sorted(
+            (methods or {}).items(), key=lambda item: len(item[0]), reverse=True)}
+        self.archive = zipfile.ZipFile(
+            filepath, mode='w', compression=compression, compresslevel=compresslevel, allowZip64=True)
 
     def writestr(self, zinfo_or_arcname: Union[str, zipfile.ZipInfo], data: bytes) -> None:
         if isinstance(data, str):
@@ -93,13 +189,175 @@ class WheelFileWriter(WheelFile):
             compresslevel=self.archive.compresslevel)
         self.entries.append((zinfo.filename, self.hash(data), len(data)))
 
-    def write(self, filename: Path, arcname: Optional[str] = None) -> None:
+    def compress_type(self, arcname: str) -> int:
+        """Return the compression method used for a file added to the archive."""
+        if self.methods:
+            name = arcname.rpartition('/')[2].lower()
+            for suffix, method in self.methods.items():
+                if name.endswith(suffix):
+                    return method
+        return self.archive.compression
+
+    def fileinfo(self, arcname: str, st: os.stat_result) -> zipfile.ZipInfo:
+        """Create the member information for a file with the given status."""
+        zinfo = zipfile.ZipInfo(arcname, date_time=self.timestamp(st.st_mtime))
+        zinfo.external_attr = (stat.S_IMODE(st.st_mode) | stat.S_IFMT(st.st_mode)) << 16
+        zinfo.file_size = st.st_size
+        zinfo.compress_type = self.compress_type(arcname)
+        zinfo._compresslevel = self.archive.compresslevel  # type: ignore[attr-defined]
+        return zinfo
+
+    def write(self, filename: Path, arcname: Optional[str] = None, patches: Sequence[Tuple[int, bytes]] = ()) -> None:
+        """Add a file to the archive.
+
+        The optional patches, a sequence of offsets and data, are
+        applied to the file content as it is read: this allows to add a
+        modified copy of a file without altering the original.
+        """
         with open(filename, 'rb') as f:
             st = os.fstat(f.fileno())
-            data = f.read()
-        zinfo = zipfile.ZipInfo(arcname or str(filename), date_time=self.timestamp(st.st_mtime))
-        zinfo.external_attr = (stat.S_IMODE(st.st_mode) | stat.S_IFMT(st.st_mode)) << 16
-        self.writestr(zinfo, data)
+            zinfo = self.fileinfo(arcname or str(filename), st)
+            self.writefile(zinfo, PatchedFile(f, patches) if patches else f, st.st_size)
+
+    def writefile(self, zinfo: zipfile.ZipInfo, fileobj: Readable, size: int) -> None:
+        """Add a member reading its content from a file object in chunks.
+
+        The content is hashed and compressed incrementally, thus memory
+        usage does not depend on the file size. The expected size is
+        used to determine whether the ZIP64 extensions are required,
+        exactly as it would be done when adding the data all at once.
+        """
+        if size <= CHUNK_SIZE:
+            # Compressing small files in memory and adding the member at
+            # once avoids rewriting the local file header, a noticeable
+            # cost when adding many small files.
+            self.writecompressed(self.compressfile(zinfo, fileobj))
+            return
+        zinfo.file_size = size
+        sha256 = hashlib.sha256()
+        length = 0
+        with self.archive.open(zinfo, 'w') as dst:
+            while True:
+                chunk = fileobj.read(CHUNK_SIZE)
+                if not chunk:
+                    break
+                sha256.update(chunk)
+                length += len(chunk)
+                dst.write(chunk)
+        digest = 'sha256=' + _b64encode(sha256.digest()).decode('ascii')
+        self.digests[zinfo.filename] = digest
+        self.entries.append((zinfo.filename, digest, length))
+
+    def compress(self, filename: Path, arcname: str, patches: Sequence[Tuple[int, bytes]] = ()) -> CompressedMember:
+        """Compress a file in preparation for adding it to the archive.
+
+        This does not access the archive and can be called concurrently
+        from multiple threads: hashing and compression release the GIL.
+        The compressor is fed the same sequence of chunks as when the
+        file is added with :meth:`write`, therefore the compressed data
+        is byte-for-byte identical.
+        """
+        with open(filename, 'rb') as f:
+            st = os.fstat(f.fileno())
+            return self.compressfile(self.fileinfo(arcname, st), PatchedFile(f, patches) if patches else f)
+
+    def compressfile(self, zinfo: zipfile.ZipInfo, fileobj: Readable) -> CompressedMember:
+        """Compress the content of a file object, see :meth:`compress`."""
+        compressor = zipfile._get_compressor(zinfo.compress_type, zinfo._compresslevel)  # type: ignore[attr-defined]
+        sha256 = hashlib.sha256()
+        crc = 0
+        size = 0
+        data = []
+        while True:
+            chunk = fileobj.read(CHUNK_SIZE)
+            if not chunk:
+                break
+            sha256.update(chunk)
+            crc = zlib.crc32(chunk, crc)
+            size += len(chunk)
+            data.append(compressor.compress(chunk) if compressor else chunk)
+        if compressor:
+            data.append(compressor.flush())
+        zinfo.CRC = crc
+        zinfo.file_size = size
+        digest = 'sha256=' + _b64encode(sha256.digest()).decode('ascii')
+        return CompressedMember(zinfo, b''.join(data), digest)
+
+    def writecompressed(self, member: CompressedMember) -> None:
+        """Add a member compressed with :meth:`compress` to the archive."""
+        # This replicates what ZipFile.open(zinfo, 'w') does when
+        # writing to a seekable file, except that the local file
+        # header is written only once, with the final CRC and sizes.
+        archive = self.archive
+        zinfo = member.zinfo
+        zinfo.compress_size = len(member.data)
+        zinfo.flag_bits = 0x00
+        if zinfo.compress_type == zipfile.ZIP_LZMA:
+            zinfo.flag_bits |= 0x02
+        zip64 = zinfo.file_size * 1.05 > zipfile.ZIP64_LIMIT
+        archive.fp.seek(archive.start_dir)  # type: ignore[union-attr]
+        zinfo.header_offset = archive.fp.tell()  # type: ignore[union-attr]
+        archive._writecheck(zinfo)  # type: ignore[attr-defined]
+        archive._didModify = True  # type: ignore[attr-defined]
+        archive.fp.write(zinfo.FileHeader(zip64))  # type: ignore[union-attr]
+        archive.fp.write(member.data)  # type: ignore[union-attr]
+        archive.start_dir = archive.fp.tell()  # type: ignore[attr-defined,union-attr]
+        archive.filelist.append(zinfo)
+        archive.NameToInfo[zinfo.filename] = zinfo
+        self.digests[zinfo.filename] = member.digest
+        self.entries.append((zinfo.filename, member.digest, zinfo.file_size))
+
+    def writecopy(self, zinfo: zipfile.ZipInfo, arcname: str) -> None:
+        """Add a member with the same content as a member added from a file.
+
+        The compressed data is copied in chunks from the archive being
+        written, without decompressing and compressing it again, thus
+        memory usage does not depend on the member size. The member
+        information must specify the same compression method.
+        """
+        archive = self.archive
+        fp = archive.fp
+        assert fp is not None  # help mypy out
+        original = archive.getinfo(arcname)
+        assert zinfo.compress_type == original.compress_type
+        fp.seek(original.header_offset)
+        header = fp.read(zipfile.sizeFileHeader)
+        name_length, extra_length = struct.unpack_from('<HH', header, 26)
+        offset = original.header_offset + zipfile.sizeFileHeader + name_length + extra_length
+        zinfo.CRC = original.CRC
+        zinfo.file_size = original.file_size
+        zinfo.compress_size = original.compress_size
+        zinfo.flag_bits = 0x00
+        if zinfo.compress_type == zipfile.ZIP_LZMA:
+            zinfo.flag_bits |= 0x02
+        zip64 = zinfo.file_size * 1.05 > zipfile.ZIP64_LIMIT
+        zinfo.header_offset = archive.start_dir  # type: ignore[attr-defined]
+        archive._writecheck(zinfo)  # type: ignore[attr-defined]
+        archive._didModify = True  # type: ignore[attr-defined]
+        fp.seek(zinfo.header_offset)
+        fp.write(zinfo.FileHeader(zip64))
+        position = fp.tell()
+        remaining = original.compress_size
+        while remaining:
+            fp.seek(offset)
+            chunk = fp.read(min(remaining, CHUNK_SIZE))
+            if not chunk:
+                raise zipfile.BadZipFile(f'Truncated member {arcname!r}')
+            offset += len(chunk)
+            remaining -= len(chunk)
+            fp.seek(position)
+            fp.write(chunk)
+            position += len(chunk)
+        archive.start_dir = position  # type: ignore[attr-defined]
+        archive.filelist.append(zinfo)
+        archive.NameToInfo[zinfo.filename] = zinfo
+        digest = self.digests[arcname]
+        self.digests[zinfo.filename] = digest
+        self.entries.append((zinfo.filename, digest, zinfo.file_size))
+
+    def digest(self, arcname: str) -> str:
+        """Return the RECORD digest of the content of a member added from a file."""
+        return self.digests[arcname]
 
     def close(self) -> None:
         record = f'{self.name}-{self.version}.dist-info/RECORD'
@@ -114,3 +372,118 @@ class WheelFileWriter(WheelFile):
             compress_type=self.archive.compression,
             compresslevel=self.archive.compresslevel)
         self.archive.close()
+
+
+class WheelIndex:
+    """Index of the members of a wheel added from files.
+
+    For each member, the index records the status of the file it has
+    been added from, the archive member information, and the position
+    of the compressed data in the archive. When the same files are added
+    to a new wheel, the members for which the file status and the member
+    information are unchanged are copied from the previous wheel, without
+    reading and compressing the files again. The key identifies the
+    remaining parameters that affect the content of the members: when it
+    differs, the index is discarded.
+    """
+
+    VERSION = 1
+
+    def __init__(self, path: Path, key: Dict[str, Any]):
+        self._path = path
+        self._key = key
+        self._previous: Dict[str, Dict[str, Any]] = {}
+        self._files: Dict[str, Tuple[Path, os.stat_result]] = {}
+        self._wheel: Optional[IO[bytes]] = None
+        self._lock = threading.Lock()
+        try:
+            with open(path, encoding='utf-8') as f:
+                index = json.load(f)
+            if index['version'] != self.VERSION or index['key'] != key:
+                return
+            st = os.stat(index['wheel'])
+            if st.st_size != index['size'] or st.st_mtime_ns != index['mtime']:
+                return
+            self._wheel = open(index['wheel'], 'rb')
+            self._previous = index['members']
+        except (OSError, ValueError, KeyError, TypeError):
+            pass
+
+    def lookup(self, zinfo: zipfile.ZipInfo, filename: Path, st: os.stat_result) -> Optional[CompressedMember]:
+        """Return the member of the previous wheel to reuse, if any.
+
+        The file status and the member information are recorded in the
+        new index regardless. This can be called concurrently from
+        multiple threads.
+        """
+        self.record(zinfo, filename, st)
+        entry = self._previous.get(zinfo.filename)
+        if self._wheel is None or entry is None:
+            return None
+        if (entry['file'] != os.fspath(filename) or entry['size'] != st.st_size or entry['mtime'] != st.st_mtime_ns
+                or entry['attributes'] != self._attributes(zinfo)):
+            return None
+        with self._lock:
+            self._wheel.seek(entry['offset'])
+            header = self._wheel.read(zipfile.sizeFileHeader)
+            signature, = struct.unpack_from('<4s', header)
+            if signature != zipfile.stringFileHeader:
+                return None
+            name_length, extra_length = struct.unpack_from('<HH', header, 26)
+            self._wheel.seek(name_length + extra_length, os.SEEK_CUR)
+            data = self._wheel.read(entry['compress_size'])
+        if len(data) != entry['compress_size']:
+            return None
+        zinfo.CRC = entry['crc']
+        zinfo.file_size = entry['file_size']
+        return CompressedMember(zinfo, data, entry['digest'])
+
+    def record(self, zinfo: zipfile.ZipInfo, filename: Path, st: os.stat_result) -> None:
+        """Record the status of the file a member is added from."""
+        self._files[zinfo.filename] = (filename, st)
+
+    @staticmethod
+    def _attributes(zinfo: zipfile.ZipInfo) -> List[Any]:
+        return [list(zinfo.date_time), zinfo.external_attr, zinfo.compress_type, zinfo._compresslevel]  # type: ignore[attr-defined]
+
+    def save(self, wheel: WheelFileWriter, filename: Path) -> None:
+        """Write the index for wheel, closed and stored at filename."""
+        digests = {name: digest for name, digest, _ in wheel.entries}
+        members = {}
+        for zinfo in wheel.archive.infolist():
+            if zinfo.filename not in self._files:
+                continue
+            file, st = self._files[zinfo.filename]
+            members[zinfo.filename] = {
+                'file': os.fspath(file),
+                'size': st.st_size,
+                'mtime': st.st_mtime_ns,
+                'attributes': self._attributes(zinfo),
+                'crc': zinfo.CRC,
+                'file_size': zinfo.file_size,
+                'compress_size': zinfo.compress_size,
+                'offset': zinfo.header_offset,
+                'digest': digests[zinfo.filename],
+            }
+        st = os.stat(filename)
+        index = {
+            'version': self.VERSION,
+            'key': self._key,
+            'wheel': os.fspath(os.path.abspath(filename)),
+            'size': st.st_size,
+            'mtime': st.st_mtime_ns,
+            'members': members,
+        }
+        with open(self._path, 'w', encoding='utf-8') as f:
+            json.dump(index, f)
+
+    def close(self) -> None:
+        if self._wheel is not None:
+            self._wheel.close()
+            self._wheel = None
+
+    def __enter__(self) -> WheelIndex:
+        return self
+
+    def __exit__(self, exc_type: Type[BaseException], exc_val: BaseException, exc_tb: TracebackType) -> None:
+        self.close()
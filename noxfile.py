@@ -64,3 +64,14 @@ def test(session):
         f'--cov-report=xml:{xmlcov_output}',
         *session.posargs
     )
+
+
+@nox.session()
+def benchmark(session):
+    """
+    Benchmark the build hooks on the test packages. Pass package names to select them.
+    """
+
+    session.install('.[test]')
+
+    session.run('python', os.path.join('benchmarks', 'benchmark.py'), *session.posargs)
@@ -164,3 +164,13 @@ def disable_pip_version_check():
     mpatch = pytest.MonkeyPatch()
     yield mpatch.setenv('PIP_DISABLE_PIP_VERSION_CHECK', '1')
     mpatch.undo()
+
+
+@pytest.fixture(autouse=True, scope='session')
+def cache_dir(tmp_path_factory):
+    # Do not use or modify the user cache directory.
+    mpatch = pytest.MonkeyPatch()
+    path = tmp_path_factory.mktemp('cache')
+    mpatch.setattr(mesonpy, '_cache_dir', lambda: path)
+    yield path
+    mpatch.undo()
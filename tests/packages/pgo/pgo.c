@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2026 The meson-python developers
+//
+// SPDX-License-Identifier: MIT
+
+#include <Python.h>
+
+static PyObject* collatz(PyObject* self, PyObject *args)
+{
+    long n, steps = 0;
+    if (!PyArg_ParseTuple(args, "l", &n)) {
+        return NULL;
+    }
+
+    while (n > 1) {
+        n = (n % 2) ? 3 * n + 1 : n / 2;
+        steps++;
+    }
+
+    return PyLong_FromLong(steps);
+}
+
+static PyMethodDef methods[] = {
+    {"collatz", (PyCFunction)collatz, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT,
+    "pgo",
+    NULL,
+    -1,
+    methods,
+};
+
+PyMODINIT_FUNC PyInit_pgo(void)
+{
+    return PyModule_Create(&module);
+}
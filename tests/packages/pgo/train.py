@@ -0,0 +1,8 @@
+# SPDX-FileCopyrightText: 2026 The meson-python developers
+#
+# SPDX-License-Identifier: MIT
+
+import pgo
+
+
+assert pgo.collatz(27) == 111
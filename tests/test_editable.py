@@ -2,13 +2,20 @@
 #
 # SPDX-License-Identifier: MIT
 
+import importlib.util
 import io
+import json
 import os
 import pathlib
 import pkgutil
 import re
+import struct
 import subprocess
 import sys
+import textwrap
+import threading
+import time
+import types
 
 from contextlib import redirect_stdout
 
@@ -36,12 +43,25 @@ def test_walk(package_complex):
         [os.path.normpath('more/meson.build'), os.path.normpath('more/baz.pyx')],
         [os.path.normpath('namespace')],
     )
-    assert {pathlib.Path(x) for x in entries} == {
+    assert {pathlib.Path(x) for x, _ in entries} == {
         pathlib.Path('__init__.py'),
         pathlib.Path('more/__init__.py'),
     }
 
 
+def test_walk_order(tmp_path):
+    for name in ('b/d/e', 'b/c', 'a', 'c/f'):
+        path = tmp_path / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(name)
+    entries = list(_editable.walk(os.fspath(tmp_path), set(), {'c'}))
+    # files are listed before the content of subdirectories, in sorted order
+    assert [pathlib.Path(x) for x, _ in entries] == [pathlib.Path(x) for x in ('a', 'b/c', 'b/d/e')]
+    for relpath, entry in entries:
+        assert entry.path == os.path.join(tmp_path, relpath)
+        assert entry.stat().st_size == len(pathlib.Path(relpath).as_posix())
+
+
 def test_nodes_tree():
     tree = _editable.Node()
     tree[('aa', 'bb', 'cc')] = 'path1'
@@ -75,6 +95,111 @@ def test_collect(package_complex):
     assert tree['complex']['more']['__init__.py'] == os.path.join(root, 'complex', 'more', '__init__.py')
 
 
+def test_module_table():
+    tree = _editable.Node()
+    tree[('pkg', '__init__.py')] = '/src/pkg/__init__.py'
+    tree[('pkg', 'mod.py')] = '/src/pkg/mod.py'
+    tree[('pkg', f'ext{EXT_SUFFIX}')] = '/build/ext.so'
+    tree[('pkg', 'ext.py')] = '/src/pkg/ext.py'
+    tree[('pkg', 'data.txt')] = '/src/pkg/data.txt'
+    tree[('pkg', 'namespace', 'foo.py')] = '/src/pkg/namespace/foo.py'
+    tree[('pkg', 'shadow', 'bar.py')] = '/src/pkg/shadow/bar.py'
+    tree[('pkg', 'shadow.py')] = '/src/pkg/shadow.py'
+    table = _editable.module_table(tree)
+
+    names = ['pkg', 'pkg.__init__', 'pkg.mod', 'pkg.ext', 'pkg.namespace', 'pkg.namespace.foo', 'pkg.shadow', 'pkg.shadow.bar']
+    assert sorted(table) == sorted(names)
+    # the table resolves the names like the lookup in the tree
+    for name in names:
+        index, src, package = table[name]
+        spec = _editable.find_spec(name, tree)
+        if index is None:
+            assert spec.loader is None
+        else:
+            assert type(spec.loader) is _editable.LOADERS[index][0]
+            assert spec.origin == src
+        assert (spec.submodule_search_locations is not None) == package
+    assert table['pkg.ext'][1] == '/build/ext.so'
+    assert table['pkg.shadow'][1] == '/src/pkg/shadow.py'
+
+
+def test_module_listing():
+    tree = _editable.Node()
+    tree[('pkg', '__init__.py')] = '/src/pkg/__init__.py'
+    tree[('pkg', 'mod.py')] = '/src/pkg/mod.py'
+    tree[('pkg', 'mod.pyc')] = '/src/pkg/mod.pyc'
+    tree[('pkg', f'ext{EXT_SUFFIX}')] = '/build/ext.so'
+    tree[('pkg', 'data.txt')] = '/src/pkg/data.txt'
+    tree[('pkg', 'sub', '__init__.py')] = '/src/pkg/sub/__init__.py'
+    tree[('pkg', 'sub', '__init__.pyc')] = '/src/pkg/sub/__init__.pyc'
+    tree[('pkg', 'namespace', 'foo.py')] = '/src/pkg/namespace/foo.py'
+    listing = _editable.module_listing(tree['pkg'])
+    assert listing == [('mod', False), ('ext', False), ('sub', True)]
+
+    finder = _editable.MesonpyPathFinder(tree['pkg'], [('precomputed', False)])
+    assert list(finder.iter_modules('pkg.')) == [('pkg.precomputed', False)]
+    finder = _editable.MesonpyPathFinder(tree['pkg'])
+    assert list(finder.iter_modules('pkg.')) == [('pkg.mod', False), ('pkg.ext', False), ('pkg.sub', True)]
+
+
+def test_module_table_reuse(tmp_path, monkeypatch):
+    src = tmp_path / 'src'
+    src.joinpath('pkg', 'namespace').mkdir(parents=True)
+    src.joinpath('pkg', '__init__.py').touch()
+    src.joinpath('pkg', 'data.txt').touch()
+    src.joinpath('pkg', 'namespace', 'foo.py').touch()
+    build = tmp_path / 'build'
+    build.joinpath('meson-info').mkdir(parents=True)
+    build.joinpath('meson-info', 'intro-install_plan.json').write_text(json.dumps({
+        'install_subdirs': {
+            os.fspath(src / 'pkg'): {
+                'destination': os.path.join('{py_purelib}', 'pkg'),
+                'tag': None}
+        }
+    }))
+
+    calls = []
+    collect = _editable.collect
+
+    def counting_collect(*args):
+        calls.append(args)
+        return collect(*args)
+
+    monkeypatch.setattr(_editable, 'collect', counting_collect)
+    loads = []
+    load_modules = _editable.MesonpyMetaFinder._load_modules
+
+    def counting_load_modules(self):
+        loads.append(self)
+        return load_modules(self)
+
+    monkeypatch.setattr(_editable.MesonpyMetaFinder, '_load_modules', counting_load_modules)
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(build), [sys.executable, '-c', ''])
+
+    assert finder.find_spec('pkg').origin == os.fspath(src / 'pkg' / '__init__.py')
+    assert len(calls) == 1
+    # the table collected by the build is used without loading it again
+    assert len(loads) == 1
+
+    # the table written after the build is reused
+    finder._current = None
+    spec = finder.find_spec('pkg')
+    assert spec.origin == os.fspath(src / 'pkg' / '__init__.py')
+    assert spec.loader.get_resource_reader('pkg').files().joinpath('data.txt').is_file()
+    assert finder.find_spec('pkg.namespace').loader is None
+    assert finder.find_spec('pkg.namespace.foo').origin == os.fspath(src / 'pkg' / 'namespace' / 'foo.py')
+    assert finder.find_spec('pkg.namespace.bar') is None
+    assert list(finder._path_hook(os.path.join(_editable.__file__, 'pkg.namespace')).iter_modules('')) == [('foo', False)]
+    assert len(calls) == 1
+
+    # until a directory walked to build it changes
+    src.joinpath('pkg', 'namespace', 'bar.py').touch()
+    os.utime(src / 'pkg' / 'namespace', ns=(0, 0))
+    finder._current = None
+    assert finder.find_spec('pkg.namespace.bar').origin == os.fspath(src / 'pkg' / 'namespace' / 'bar.py')
+    assert len(calls) == 2
+
+
 def test_mesonpy_meta_finder(package_complex, tmp_path):
     # build a package in a temporary directory
     mesonpy.Project(package_complex, tmp_path)
@@ -279,7 +404,7 @@ def test_editable_rebuild(package_purelib_and_platlib, tmp_path, verbose, args):
 
             # Reset state.
             del sys.modules['pure']
-            finder._rebuild.cache_clear()
+            finder._current = None
 
             # Importing again should result in no output.
             stdout = io.StringIO()
@@ -292,6 +417,275 @@ def test_editable_rebuild(package_purelib_and_platlib, tmp_path, verbose, args):
             sys.modules.pop('pure', None)
 
 
+def test_ninja_manifest(tmp_path):
+    tmp_path.joinpath('build.ninja').write_text(textwrap.dedent('''
+        rule cc
+         command = cc -c $in -o $out
+
+        build a.o: cc ../a$ b.c | ../a.h || gen.h
+         ARGS = -I$ foo
+        build gen.h: CUSTOM_COMMAND ../gen.py $
+            ../c$:d.txt
+        build all: phony a.o
+        default all
+    '''))
+    edges, defaults = _editable.ninja_manifest(os.fspath(tmp_path / 'build.ninja'))
+    assert edges == {
+        'a.o': ('cc', ['../a b.c', '../a.h', 'gen.h']),
+        'gen.h': ('CUSTOM_COMMAND', ['../gen.py', '../c:d.txt']),
+        'all': ('phony', ['a.o']),
+    }
+    assert defaults == ['all']
+
+
+def test_ninja_deps(tmp_path):
+    # write a deps log in the format used by ninja
+    data = [b'# ninjadeps\n', struct.pack('=i', 4)]
+    for i, path in enumerate(['a.o', '../a.c', '../a.h']):
+        record = path.encode().ljust((len(path) + 3) // 4 * 4, b'\0') + struct.pack('=I', ~i & 0xffffffff)
+        data.append(struct.pack('=I', len(record)) + record)
+    record = struct.pack('=iII3i', 0, 0, 0, 1, 2, 1)
+    data.append(struct.pack('=I', len(record) | 0x80000000) + record)
+    tmp_path.joinpath('.ninja_deps').write_bytes(b''.join(data))
+    assert _editable.ninja_deps(os.fspath(tmp_path / '.ninja_deps')) == {'a.o': ['../a.c', '../a.h', '../a.c']}
+
+
+def test_build_inputs(tmp_path):
+    tmp_path.joinpath('build.ninja').write_text(textwrap.dedent('''
+        build a.o: cc ../a.c || gen.h
+        build gen.h: CUSTOM_COMMAND ../gen.py
+        build all: phony a.o
+        build run: CUSTOM_COMMAND PHONY
+        build PHONY: phony
+        build build.ninja: REGENERATE_BUILD ../meson.build
+        default all
+    '''))
+    sources, outputs = _editable.build_inputs(os.fspath(tmp_path), ['ninja'])
+    assert sources == ['../a.c', '../gen.py', '../meson.build']
+    assert outputs == ['a.o', 'build.ninja', 'gen.h']
+    # targets that are always out of date
+    assert _editable.build_inputs(os.fspath(tmp_path), ['ninja', 'run']) is None
+    # unsupported arguments
+    assert _editable.build_inputs(os.fspath(tmp_path), ['ninja', '-C', 'foo']) is None
+
+
+def test_editable_rebuild_up_to_date(package_purelib_and_platlib, tmp_path, monkeypatch):
+    with mesonpy._project({'builddir': os.fspath(tmp_path)}) as project:
+        build_command = project._build_command
+
+    # pretend that the build is started some time after the files have been modified
+    monkeypatch.setattr(_editable, 'time', types.SimpleNamespace(time_ns=lambda: time.time_ns() + 10**10))
+
+    cmds = []
+    subprocess_run = subprocess.run
+
+    def run(cmd, *args, **kwargs):
+        cmds.append(cmd)
+        return subprocess_run(cmd, *args, **kwargs)
+
+    monkeypatch.setattr(subprocess, 'run', run)
+    finder = _editable.MesonpyMetaFinder('purelib-and-platlib', {'plat', 'pure'}, os.fspath(tmp_path), build_command)
+
+    finder._rebuild()
+    assert cmds == [build_command]
+
+    # the build command is not run when no file changed
+    finder._current = None
+    finder._rebuild()
+    assert cmds == [build_command]
+
+    # but it is run when a source file changed
+    package_purelib_and_platlib.joinpath('plat.c').touch()
+    finder._current = None
+    finder._rebuild()
+    assert cmds == [build_command, build_command]
+
+
+def test_editable_watch(tmp_path, monkeypatch):
+    tmp_path.joinpath('meson-info').mkdir()
+    tmp_path.joinpath('meson-info', 'intro-install_plan.json').write_text('{}')
+    source = tmp_path / 'source.c'
+    source.touch()
+    log = tmp_path / 'log'
+    # the build command records the state a real build would record
+    build = tmp_path / 'build.py'
+    build.write_text(textwrap.dedent(f'''
+        import json, os, sys
+        open({os.fspath(log)!r}, 'a').write('x')
+        state = {{'command': [sys.executable, *sys.argv], 'files': {{'source.c': os.stat({os.fspath(source)!r}).st_mtime_ns}}}}
+        json.dump(state, open({os.fspath(tmp_path / _editable.STATE_FILE)!r}, 'w'))
+    '''))
+    cmd = [sys.executable, os.fspath(build)]
+    state = {'command': cmd, 'files': {'source.c': source.stat().st_mtime_ns}}
+    tmp_path.joinpath(_editable.STATE_FILE).write_text(json.dumps(state))
+
+    monkeypatch.setenv(_editable.WATCH, '0.05')
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(tmp_path), cmd)
+    finder._rebuild()
+    assert not log.exists()
+
+    # the build runs in the background as soon as a source changes
+    os.utime(source, ns=(0, 0))
+    deadline = time.monotonic() + 30
+    while not log.exists() and time.monotonic() < deadline:
+        time.sleep(0.05)
+    time.sleep(0.5)
+    assert log.read_text() == 'x'
+
+    finder._stop.set()
+    finder._watcher.join()
+
+
+def test_editable_watch_no_state(tmp_path, monkeypatch):
+    tmp_path.joinpath('meson-info').mkdir()
+    tmp_path.joinpath('meson-info', 'intro-install_plan.json').write_text('{}')
+    log = tmp_path / 'log'
+    cmd = [sys.executable, '-c', f'open({os.fspath(log)!r}, "a").write("x")']
+
+    # the watcher stops when the build state cannot be recorded
+    monkeypatch.setattr(_editable, 'build_inputs', lambda *args: None)
+    monkeypatch.setenv(_editable.WATCH, '0.05')
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(tmp_path), cmd)
+    finder._rebuild()
+    finder._watcher.join(30)
+    assert not finder._watcher.is_alive()
+    assert log.read_text() == 'x'
+
+
+def test_editable_rebuild_shared(tmp_path):
+    tmp_path.joinpath('meson-info').mkdir()
+    tmp_path.joinpath('meson-info', 'intro-install_plan.json').write_text('{}')
+    source = tmp_path / 'source.c'
+    source.touch()
+    log = tmp_path / 'log'
+    # the build command records the state a real build would record
+    build = tmp_path / 'build.py'
+    build.write_text(textwrap.dedent(f'''
+        import json, os, sys, time
+        time.sleep(1)
+        open({os.fspath(log)!r}, 'a').write('x')
+        state = {{'command': [sys.executable, *sys.argv], 'files': {{'source.c': os.stat({os.fspath(source)!r}).st_mtime_ns}}}}
+        json.dump(state, open({os.fspath(tmp_path / _editable.STATE_FILE)!r}, 'w'))
+    '''))
+    cmd = [sys.executable, os.fspath(build)]
+
+    # several interpreters importing the package at the same time
+    barrier = threading.Barrier(4)
+
+    def rebuild():
+        finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(tmp_path), cmd)
+        barrier.wait()
+        finder._rebuild()
+
+    threads = [threading.Thread(target=rebuild) for _ in range(barrier.parties)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    # run the build command once
+    assert log.read_text() == 'x'
+    assert tmp_path.joinpath(_editable.GENERATION_FILE).read_text().split()[0] == '1'
+    assert tmp_path.joinpath(_editable.MODULES_FILE).is_file()
+
+
+def test_editable_rebuild_stale(tmp_path):
+    tmp_path.joinpath('meson-info').mkdir()
+    tmp_path.joinpath('meson-info', 'intro-install_plan.json').write_text('{}')
+    log = tmp_path / 'log'
+    cmd = [sys.executable, '-c', f'open({os.fspath(log)!r}, "a").write("x")']
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(tmp_path), cmd)
+
+    # a build that started before the build was requested completes
+    # while waiting for the lock: its result is not reused
+    with _editable.build_lock(os.fspath(tmp_path)):
+        thread = threading.Thread(target=finder._build)
+        start = time.time_ns()
+        thread.start()
+        time.sleep(0.5)
+        tmp_path.joinpath(_editable.GENERATION_FILE).write_text(f'1 {start - 1}')
+    thread.join()
+
+    assert log.read_text() == 'x'
+    assert tmp_path.joinpath(_editable.GENERATION_FILE).read_text().split()[0] == '2'
+
+
+def test_editable_rebuild_threads(tmp_path):
+    tmp_path.joinpath('meson-info').mkdir()
+    tmp_path.joinpath('meson-info', 'intro-install_plan.json').write_text('{}')
+    log = tmp_path / 'log'
+    cmd = [sys.executable, '-c', f'import time; time.sleep(1); open({os.fspath(log)!r}, "a").write("x")']
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(tmp_path), cmd)
+
+    # several threads of one interpreter importing the package at the same time
+    barrier = threading.Barrier(8)
+    results = []
+
+    def modules():
+        barrier.wait()
+        results.append(finder._modules())
+
+    threads = [threading.Thread(target=modules) for _ in range(barrier.parties)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    # run the build command once and share the module table
+    assert log.read_text() == 'x'
+    assert len(results) == barrier.parties
+    assert all(x is results[0] for x in results)
+
+
+def test_editable_recheck(tmp_path, monkeypatch, capsys):
+    src = tmp_path / 'src'
+    src.joinpath('pkg').mkdir(parents=True)
+    src.joinpath('pkg', '__init__.py').touch()
+    src.joinpath('pkg', 'mod.py').touch()
+    build = tmp_path / 'build'
+    build.joinpath('meson-info').mkdir(parents=True)
+    build.joinpath('meson-info', 'intro-install_plan.json').write_text(json.dumps({
+        'install_subdirs': {
+            os.fspath(src / 'pkg'): {
+                'destination': os.path.join('{py_purelib}', 'pkg'),
+                'tag': None}
+        }
+    }))
+    log = tmp_path / 'log'
+    cmd = [sys.executable, '-c', f'open({os.fspath(log)!r}, "a").write("x")']
+
+    # check the build only on module reload
+    monkeypatch.setenv(_editable.RECHECK, '0')
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(build), cmd)
+    spec = finder.find_spec('pkg.mod')
+    monkeypatch.setitem(sys.modules, 'pkg.mod', importlib.util.module_from_spec(spec))
+    finder.find_spec('pkg')
+    assert log.read_text() == 'x'
+    assert finder.stale_modules() == []
+
+    os.utime(src / 'pkg' / 'mod.py', ns=(0, 0))
+    assert finder.stale_modules() == ['pkg.mod']
+    finder.find_spec('pkg', target=sys.modules['pkg.mod'])
+    assert log.read_text() == 'xx'
+    assert 'modules changed since they were imported: pkg.mod' in capsys.readouterr().err
+
+    # the module is not stale anymore once reloaded
+    finder.find_spec('pkg.mod', target=sys.modules['pkg.mod'])
+    assert log.read_text() == 'xxx'
+    assert finder.stale_modules() == []
+    assert capsys.readouterr().err == ''
+
+    # check the build at most once per interval
+    monkeypatch.setenv(_editable.RECHECK, '0.5')
+    finder = _editable.MesonpyMetaFinder('pkg', {'pkg'}, os.fspath(build), cmd)
+    finder.find_spec('pkg')
+    finder.find_spec('pkg.mod')
+    assert log.read_text() == 'xxxx'
+    time.sleep(0.5)
+    finder.find_spec('pkg.mod')
+    assert log.read_text() == 'xxxxx'
+
+
 @pytest.mark.skipif(NOGIL_BUILD and CYTHON_VERSION < (3, 1, 0),
                     reason='Cython version too old, no free-threaded CPython support')
 def test_editable_verbose(venv, package_complex, editable_complex, monkeypatch):
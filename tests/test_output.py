@@ -30,3 +30,15 @@ def test_use_ansi_escapes(mocker, monkeypatch, tty, env, colors):
     mesonpy._use_ansi_escapes.cache_clear()
 
     assert mesonpy._use_ansi_escapes() == colors
+
+
+def test_clicounter(mocker, monkeypatch, capsys):
+    mocker.patch('mesonpy._use_ansi_escapes', return_value=False)
+    clock = iter([0.0, 0.05, 0.1, 0.15, 0.3])
+    monkeypatch.setattr(mesonpy.time, 'monotonic', lambda: next(clock))
+
+    # progress is reported at most every 0.1 seconds, and on the last file
+    with mesonpy._clicounter(5) as counter:
+        for name in 'abcde':
+            counter.update(name)
+    assert capsys.readouterr().out.splitlines() == ['[1/5] a', '[3/5] c', '[5/5] e']
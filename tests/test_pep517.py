@@ -2,6 +2,7 @@
 #
 # SPDX-License-Identifier: MIT
 
+import json
 import os
 import re
 import shutil
@@ -100,6 +101,66 @@ def test_validate_config_settings_tuple():
     assert config['setup-args'] == ['-Done=1', '-Dtwo=2']
 
 
+def test_validate_config_settings_positive_int():
+    config = mesonpy._validate_config_settings({'wheel-jobs': '4'})
+    assert config['wheel-jobs'] == 4
+    with pytest.raises(mesonpy.ConfigError, match='The value for "wheel-jobs" must be a positive integer'):
+        mesonpy._validate_config_settings({'wheel-jobs': '0'})
+
+
+def test_validate_config_settings_compression_level():
+    config = mesonpy._validate_config_settings({'wheel-compression-level': '0'})
+    assert config['wheel-compression-level'] == 0
+    with pytest.raises(mesonpy.ConfigError, match='The value for "wheel-compression-level" must be an integer'):
+        mesonpy._validate_config_settings({'wheel-compression-level': '10'})
+
+
+def test_validate_config_settings_sdist_compression(mocker):
+    config = mesonpy._validate_config_settings({'sdist-compression-level': '1'})
+    assert config['sdist-compression-level'] == 1
+    with pytest.raises(mesonpy.ConfigError, match='The value for "sdist-compression" must be "gzip" or "zstd"'):
+        mesonpy._validate_config_settings({'sdist-compression': 'xz'})
+    with pytest.raises(mesonpy.ConfigError, match='must be an integer between 0 and 9 with "gzip" compression'):
+        mesonpy._validate_config_settings({'sdist-compression-level': '19'})
+    mocker.patch('mesonpy._util.zstd_available', return_value=True)
+    config = mesonpy._validate_config_settings({'sdist-compression': 'zstd', 'sdist-compression-level': '19'})
+    assert config['sdist-compression-level'] == 19
+    mocker.patch('mesonpy._util.zstd_available', return_value=False)
+    with pytest.raises(mesonpy.ConfigError, match='requires Python 3.14 or the "zstandard" package'):
+        mesonpy._validate_config_settings({'sdist-compression': 'zstd'})
+
+
+def test_validate_config_settings_timing_report():
+    config = mesonpy._validate_config_settings({'timing-report': 'trace'})
+    assert config['timing-report'] == 'trace'
+    with pytest.raises(mesonpy.ConfigError, match='The value for "timing-report" must be "json" or "trace"'):
+        mesonpy._validate_config_settings({'timing-report': 'yes'})
+
+
+def test_validate_config_settings_build_jobs():
+    config = mesonpy._validate_config_settings({'build-jobs': 'auto', 'build-job-memory': '2048'})
+    assert config['build-jobs'] == 0
+    assert config['build-job-memory'] == 2048
+    assert mesonpy._validate_config_settings({'build-jobs': '8'})['build-jobs'] == 8
+    with pytest.raises(mesonpy.ConfigError, match='The value for "build-jobs" must be a positive integer or "auto"'):
+        mesonpy._validate_config_settings({'build-jobs': 'all'})
+
+
+def test_validate_config_settings_compiler_cache():
+    config = mesonpy._validate_config_settings({'compiler-cache': 'sccache', 'compiler-cache-dir': 'cache'})
+    assert config['compiler-cache'] == 'sccache'
+    assert config['compiler-cache-dir'] == 'cache'
+    with pytest.raises(mesonpy.ConfigError, match='The value for "compiler-cache" must be "ccache" or "sccache"'):
+        mesonpy._validate_config_settings({'compiler-cache': 'distcc'})
+
+
+def test_validate_config_settings_build_profile():
+    config = mesonpy._validate_config_settings({'build-profile': 'release-lto'})
+    assert config['build-profile'] == 'release-lto'
+    with pytest.raises(mesonpy.ConfigError, match='The value for "build-profile" must be one of "release", '):
+        mesonpy._validate_config_settings({'build-profile': 'fast'})
+
+
 @pytest.mark.parametrize('meson', [None, 'meson'])
 def test_get_meson_command(monkeypatch, meson):
     # The MESON environment variable affects the meson executable lookup and breaks the test.
@@ -132,6 +193,48 @@ def test_get_meson_command_wrong_version(monkeypatch, tmp_path):
         mesonpy._get_meson_command(os.fspath(meson))
 
 
+def test_get_meson_command_cached(monkeypatch, tmp_path):
+    # The MESON environment variable affects the meson executable lookup and breaks the test.
+    monkeypatch.delenv('MESON', raising=False)
+    meson = tmp_path / 'meson.py'
+    meson.write_text(textwrap.dedent('''
+        print('1.2.3')
+    '''))
+    assert mesonpy._get_meson_command(os.fspath(meson)) == [sys.executable, os.fspath(meson)]
+
+    # the version is not probed again
+    subprocess_run = subprocess.run
+
+    def run(cmd: List[str], *args: object, **kwargs: object) -> subprocess.CompletedProcess:
+        raise AssertionError(f'Unexpected command {cmd!r}')
+
+    monkeypatch.setattr(subprocess, 'run', run)
+    assert mesonpy._get_meson_command(os.fspath(meson)) == [sys.executable, os.fspath(meson)]
+
+    # unless the executable changes
+    meson.write_text(textwrap.dedent('''
+        import sys
+        print('0.0.1')
+    '''))
+    monkeypatch.setattr(subprocess, 'run', subprocess_run)
+    with pytest.raises(mesonpy.ConfigError, match=r'Could not find meson version [0-9\.]+ or newer, found 0\.0\.1\.'):
+        mesonpy._get_meson_command(os.fspath(meson))
+
+
+def test_run_probe_cache_write_error(tmp_path, monkeypatch):
+    monkeypatch.setattr(mesonpy, '_cache_dir', lambda: tmp_path)
+
+    def dump(obj, fp):
+        fp.write('{')
+        raise OSError('No space left on device')
+
+    monkeypatch.setattr(json, 'dump', dump)
+    r = mesonpy._run_probe([sys.executable, '-c', 'print("probe")'])
+    assert r.stdout == 'probe\n'
+    # the temporary file is removed when the cache cannot be written
+    assert list(tmp_path.iterdir()) == []
+
+
 def test_get_meson_command_error(monkeypatch, tmp_path):
     # The MESON environment variable affects the meson executable lookup and breaks the test.
     monkeypatch.delenv('MESON', raising=False)
@@ -143,3 +246,21 @@ def test_get_meson_command_error(monkeypatch, tmp_path):
     '''))
     with pytest.raises(mesonpy.ConfigError, match=re.escape('Could not execute meson: Just testing')):
         mesonpy._get_meson_command(os.fspath(meson))
+
+
+def test_prepare_metadata_for_build_wheel(package_dynamic_version, tmp_path, mocker):
+    run = mocker.spy(mesonpy.Project, '_run')
+    name = mesonpy.prepare_metadata_for_build_wheel(os.fspath(tmp_path))
+    assert name == 'dynamic_version-1.0.0.dist-info'
+    assert 'Version: 1.0.0' in tmp_path.joinpath(name, 'METADATA').read_text()
+    assert 'Tag: py3-none-any' in tmp_path.joinpath(name, 'WHEEL').read_text()
+
+    # the project is configured but not built
+    assert len(run.call_args_list) == 1
+    assert run.call_args_list[0].args[1][1] == 'setup'
+
+    # the build directory configured by the metadata hook is reused
+    run.reset_mock()
+    filename = mesonpy.build_wheel(os.fspath(tmp_path), metadata_directory=os.fspath(tmp_path / name))
+    assert filename == 'dynamic_version-1.0.0-py3-none-any.whl'
+    assert not any('setup' in call.args[1] for call in run.call_args_list)
@@ -3,10 +3,14 @@
 # SPDX-License-Identifier: MIT
 
 import ast
+import json
+import math
 import os
 import shutil
+import subprocess
 import sys
 import textwrap
+import zipfile
 
 
 if sys.version_info < (3, 11):
@@ -120,6 +124,33 @@ def test_install_tags(package_purelib_and_platlib, tmp_path_session):
     assert 'platlib' not in project._manifest
 
 
+@pytest.mark.skipif(sys.platform not in {'linux', 'darwin'}, reason='Not supported on this platform')
+def test_native_files(package_link_against_local_lib, tmp_path):
+    project = mesonpy.Project(package_link_against_local_lib, tmp_path)
+    native_files = project._native_files
+    for _, src, _ in project._manifest['platlib'] + project._manifest['mesonpy-libs']:
+        assert native_files[os.path.normpath(src)]
+
+
+def test_map_to_wheel_status(tmp_path):
+    tmp_path.joinpath('pkg', 'sub').mkdir(parents=True)
+    tmp_path.joinpath('pkg', 'sub', 'data.txt').write_text('data')
+    tmp_path.joinpath('module.py').write_text('')
+    manifest = mesonpy._map_to_wheel({
+        'install_subdirs': {os.fspath(tmp_path / 'pkg'): {'destination': '{py_purelib}/pkg'}},
+        'python_sources': {
+            os.fspath(tmp_path / 'module.py'): {'destination': '{py_purelib}/module.py'},
+            os.fspath(tmp_path / 'missing.py'): {'destination': '{py_purelib}/missing.py'},
+        },
+    })
+    # the entries carry the status of the files, when they exist
+    assert [(dst, src, st and st.st_size) for dst, src, st in manifest['purelib']] == [
+        ('pkg/sub/data.txt', os.fspath(tmp_path / 'pkg' / 'sub' / 'data.txt'), 4),
+        ('module.py', os.fspath(tmp_path / 'module.py'), 0),
+        ('missing.py', os.fspath(tmp_path / 'missing.py'), None),
+    ]
+
+
 def test_validate_pyproject_config_one():
     pyproject_config = tomllib.loads(textwrap.dedent('''
         [tool.meson-python.args]
@@ -154,6 +185,50 @@ def test_validate_pyproject_config_unknown():
         mesonpy._validate_pyproject_config(pyproject_config)
 
 
+def test_validate_pyproject_config_compression_level():
+    pyproject_config = tomllib.loads(textwrap.dedent('''
+        [tool.meson-python]
+        wheel-compression-level = 0
+    '''))
+    conf = mesonpy._validate_pyproject_config(pyproject_config)
+    assert conf['wheel-compression-level'] == 0
+
+
+@pytest.mark.parametrize('value', ['10', '-1', 'true', '"9"'])
+def test_validate_pyproject_config_compression_level_invalid(value):
+    pyproject_config = tomllib.loads(textwrap.dedent(f'''
+        [tool.meson-python]
+        wheel-compression-level = {value}
+    '''))
+    with pytest.raises(mesonpy.ConfigError, match='must be an integer between 0 and 9'):
+        mesonpy._validate_pyproject_config(pyproject_config)
+
+
+def test_validate_pyproject_config_compression_methods():
+    pyproject_config = tomllib.loads(textwrap.dedent('''
+        [tool.meson-python.wheel-compression-methods]
+        '.png' = 'stored'
+        '.py' = 'deflated'
+    '''))
+    conf = mesonpy._validate_pyproject_config(pyproject_config)
+    assert conf['wheel-compression-methods'] == {'.png': zipfile.ZIP_STORED, '.py': zipfile.ZIP_DEFLATED}
+
+
+@pytest.mark.parametrize(('value', 'match'), [
+    ('".png"', 'must be a table'),
+    ('{ png = "stored" }', 'must map file name suffixes'),
+    ('{ ".png" = "bzip2" }', 'must map file name suffixes'),
+    ('{ ".png" = ["stored"] }', 'must map file name suffixes'),
+])
+def test_validate_pyproject_config_compression_methods_invalid(value, match):
+    pyproject_config = tomllib.loads(textwrap.dedent(f'''
+        [tool.meson-python]
+        wheel-compression-methods = {value}
+    '''))
+    with pytest.raises(mesonpy.ConfigError, match=match):
+        mesonpy._validate_pyproject_config(pyproject_config)
+
+
 def test_validate_pyproject_config_empty():
     pyproject_config = tomllib.loads(textwrap.dedent(''))
     config = mesonpy._validate_pyproject_config(pyproject_config)
@@ -175,8 +250,17 @@ def test_invalid_build_dir(package_pure, tmp_path, mocker):
     project.build()
     meson.reset_mock()
 
-    # subsequent builds with the same build directory result in a setup --reconfigure
+    # subsequent builds with the same build directory and setup options do not run setup again
+    native_file = tmp_path / 'meson-python-native-file.ini'
+    mtime = native_file.stat().st_mtime_ns
     project = mesonpy.Project(package_pure, tmp_path)
+    assert len(meson.call_args_list) == 0
+    assert native_file.stat().st_mtime_ns == mtime
+    project.build()
+    meson.reset_mock()
+
+    # subsequent builds with the same build directory and different setup options result in a setup --reconfigure
+    project = mesonpy.Project(package_pure, tmp_path, {'setup': ['-Dbuildtype=debug']})
     assert len(meson.call_args_list) == 1
     assert meson.call_args_list[0].args[1][1] == 'setup'
     assert '--reconfigure' in meson.call_args_list[0].args[1]
@@ -244,3 +328,183 @@ def test_archflags_envvar_parsing_invalid(package_purelib_and_platlib, monkeypat
     finally:
         # revert environment variable setting done by the in-process build
         os.environ.pop('_PYTHON_HOST_PLATFORM', None)
+
+
+def test_build_parallelism(tmp_path):
+    available = len(os.sched_getaffinity(0)) if hasattr(os, 'sched_getaffinity') else os.cpu_count()
+
+    # cgroup v2 hierarchy, limited by the enclosing cgroup
+    (tmp_path / 'proc' / 'self').mkdir(parents=True)
+    (tmp_path / 'proc' / 'self' / 'cgroup').write_text('0::/pod/container\n')
+    cgroup = tmp_path / 'sys' / 'fs' / 'cgroup'
+    (cgroup / 'pod' / 'container').mkdir(parents=True)
+    (cgroup / 'pod' / 'container' / 'cpu.max').write_text('max 100000\n')
+    (cgroup / 'pod' / 'container' / 'memory.max').write_text('max\n')
+    (cgroup / 'pod' / 'cpu.max').write_text('250000 100000\n')
+    (cgroup / 'pod' / 'memory.max').write_text(f'{2 * 2**30}\n')
+
+    root = os.fspath(tmp_path)
+    cpus = max(1, min(2.5, available))
+    assert mesonpy._util.cpu_limit(root) == cpus
+    assert mesonpy._util.memory_limit(root) <= 2 * 2**30
+    assert mesonpy._util.build_parallelism(None, root) == (math.ceil(cpus), cpus)
+    assert mesonpy._util.build_parallelism(2**30, root) == (min(2, math.ceil(cpus)), cpus)
+
+    # cgroup v1 hierarchy, without limits
+    (tmp_path / 'proc' / 'self' / 'cgroup').write_text('4:memory:/\n2:cpu,cpuacct:/\n')
+    (cgroup / 'cpu,cpuacct').mkdir()
+    (cgroup / 'cpu,cpuacct' / 'cpu.cfs_quota_us').write_text('-1\n')
+    (cgroup / 'cpu,cpuacct' / 'cpu.cfs_period_us').write_text('100000\n')
+    (cgroup / 'memory').mkdir()
+    (cgroup / 'memory' / 'memory.limit_in_bytes').write_text('9223372036854771712\n')
+    assert mesonpy._util.cpu_limit(root) == available
+    assert mesonpy._util.build_parallelism(2**70, root) == (1, available)
+
+
+@pytest.mark.parametrize(('settings', 'args'), [
+    ({}, []),
+    ({'build-jobs': '3'}, ['-j3']),
+    ({'build-jobs': 'auto'}, ['-j2', '-l1.5']),
+    ({'build-job-memory': '1024'}, ['-j2', '-l1.5']),
+    ({'build-jobs': 'auto', 'compile-args': '-j1'}, ['-j2', '-l1.5', '-j1']),
+])
+def test_build_jobs(package_pure, monkeypatch, settings, args):
+    def parallelism(job_memory):
+        assert job_memory == (2**30 if 'build-job-memory' in settings else None)
+        return 2, 1.5
+
+    monkeypatch.setattr(mesonpy._util, 'build_parallelism', parallelism)
+    with mesonpy._project(settings) as project:
+        cmd = project._build_command
+    if sys.platform == 'win32':
+        # the arguments are passed to ninja via the --ninja-args option
+        ninja_args = ast.literal_eval(cmd[-1].split('=', 1)[1]) if cmd[-1].startswith('--ninja-args=') else []
+        assert ninja_args == args
+    else:
+        assert cmd[1:] == args
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='uses POSIX file locks')
+def test_build_dir_lock(package_pure, tmp_path, monkeypatch):
+    import fcntl
+
+    monkeypatch.delenv(mesonpy._editable.MARKER, raising=False)
+    lock = tmp_path / mesonpy._editable.LOCK_FILE
+    with mesonpy._project({'build-dir': os.fspath(tmp_path)}) as project:
+        # the build directory is locked while the project is built
+        with open(lock, 'a+b') as f:
+            with pytest.raises(BlockingIOError):
+                fcntl.flock(f.fileno(), fcntl.LOCK_EX | fcntl.LOCK_NB)
+        # and the editable install loader does not rebuild it
+        assert os.environ[mesonpy._editable.MARKER] == os.fspath(project._build_dir)
+    assert mesonpy._editable.MARKER not in os.environ
+    with open(lock, 'a+b') as f:
+        fcntl.flock(f.fileno(), fcntl.LOCK_EX | fcntl.LOCK_NB)
+
+
+def test_compiler_cache_environment(monkeypatch, tmp_path):
+    monkeypatch.setattr(shutil, 'which', lambda name: f'/usr/bin/{name}')
+    for name in 'CC', 'CXX', 'OBJC', 'OBJCXX', 'CCACHE_BASEDIR', 'CCACHE_HASHDIR', 'CCACHE_NOHASHDIR':
+        monkeypatch.delenv(name, raising=False)
+    monkeypatch.setenv('CC', 'gcc -m64')
+    monkeypatch.setenv('CXX', 'ccache g++')
+
+    env = mesonpy._compiler_cache_environment('ccache', 'cache', tmp_path)
+    assert env == {
+        'CC': 'ccache gcc -m64',
+        'CCACHE_BASEDIR': os.fspath(tmp_path),
+        'CCACHE_NOHASHDIR': '1',
+        'CCACHE_DIR': os.path.abspath('cache'),
+    }
+
+    monkeypatch.setenv('CCACHE_HASHDIR', '1')
+    env = mesonpy._compiler_cache_environment('sccache', None, tmp_path)
+    assert env == {'CC': 'sccache gcc -m64'}
+
+    monkeypatch.setattr(shutil, 'which', lambda name: None)
+    with pytest.raises(mesonpy.ConfigError, match='Could not find compiler cache "ccache"'):
+        mesonpy._compiler_cache_environment('ccache', None, tmp_path)
+
+
+def test_compiler_cache_compilers(tmp_path):
+    assert mesonpy._compiler_cache_compilers('ccache', tmp_path) == {}
+
+    tmp_path.joinpath('meson-info').mkdir()
+    tmp_path.joinpath('meson-info', 'intro-compilers.json').write_text(json.dumps({'host': {
+        'c': {'id': 'gcc', 'exelist': ['sccache', 'cc']},
+        'cpp': {'id': 'gcc', 'exelist': ['ccache', 'c++']},
+        'objc': {'id': 'clang', 'exelist': ['/opt/llvm/bin/clang', '-m64']},
+        'cython': {'id': 'cython', 'exelist': ['cython']},
+    }, 'build': {}}))
+    # the compilers not using the selected compiler cache are prefixed with it
+    assert mesonpy._compiler_cache_compilers('ccache', tmp_path) == {
+        'CC': 'ccache cc',
+        'OBJC': 'ccache /opt/llvm/bin/clang -m64',
+    }
+
+
+def test_build_profile(package_link_against_local_lib, tmp_path, mocker):
+    meson = mocker.spy(mesonpy.Project, '_run')
+    mesonpy.Project(package_link_against_local_lib, tmp_path, {'setup': ['-Db_lto=false']}, build_profile='release-lto')
+    args = meson.call_args_list[0][0][1]
+    assert args[1] == 'setup'
+    # the profile options are overridden by the user options
+    assert args.index('-Dbuildtype=release') < args.index('-Db_lto=true') < args.index('-Db_lto=false')
+    assert f'-Db_lto_threads={math.ceil(mesonpy._util.cpu_limit())}' in args
+
+
+@pytest.mark.parametrize(('compilers', 'supported'), [
+    ({'c': {'id': 'clang', 'linker_id': 'ld.lld'}, 'cpp': {'id': 'clang', 'linker_id': 'ld.lld'}}, True),
+    ({'c': {'id': 'clang', 'linker_id': 'ld.bfd'}}, False),
+    ({'c': {'id': 'gcc', 'linker_id': 'ld.bfd'}}, False),
+    ({'c': {'id': 'clang', 'linker_id': 'ld64'}, 'cython': {'id': 'cython'}}, True),
+    (None, False),
+])
+def test_thin_lto_supported(tmp_path, compilers, supported):
+    if compilers is not None:
+        tmp_path.joinpath('meson-info').mkdir()
+        tmp_path.joinpath('meson-info', 'intro-compilers.json').write_text(json.dumps({'host': compilers, 'build': {}}))
+    assert mesonpy._thin_lto_supported(tmp_path) == supported
+
+
+def test_build_profile_environment(monkeypatch):
+    monkeypatch.setattr(sys, 'platform', 'linux')
+    monkeypatch.setattr(shutil, 'which', lambda name: f'/usr/bin/{name}')
+    # the compiler does not support mold, like GCC before version 12.1
+    probes = []
+
+    def run_probe(cmd):
+        probes.append(cmd)
+        return subprocess.CompletedProcess(cmd, 1 if '-fuse-ld=mold' in cmd else 0, '', '')
+
+    monkeypatch.setattr(mesonpy, '_run_probe', run_probe)
+    monkeypatch.setenv('CC', 'gcc -m64')
+    monkeypatch.setenv('CXX_LD', 'gold')
+    monkeypatch.setenv('CFLAGS', '-O1')
+    monkeypatch.setenv('CXXFLAGS', '-gsplit-dwarf')
+    monkeypatch.delenv('CC_LD', raising=False)
+    assert mesonpy._build_profile_environment('dev-fast') == {'CC_LD': 'lld', 'CFLAGS': '-O1 -gsplit-dwarf'}
+    assert probes == [['gcc', '-m64', '-fuse-ld=mold', '-Wl,--version'], ['gcc', '-m64', '-fuse-ld=lld', '-Wl,--version']]
+    assert mesonpy._build_profile_environment('release-lto') == {}
+
+
+def test_build_profile_environment_setup(package_pure, tmp_path, mocker, monkeypatch):
+    monkeypatch.delenv('CFLAGS', raising=False)
+    mesonpy.Project(package_pure, tmp_path)
+
+    # the environment is passed to Meson and not left behind, and the
+    # build directory is set up again for the compilers to be detected
+    run = mocker.spy(mesonpy.Project, '_run')
+    mocker.patch('mesonpy._build_profile_environment', return_value={'CFLAGS': '-gsplit-dwarf'})
+    mesonpy.Project(package_pure, tmp_path, build_profile='dev-fast')
+    assert 'CFLAGS' not in os.environ
+    args, _ = run.call_args_list[0]
+    assert args[1][1:3] == ['setup', '--wipe']
+    assert run.call_args_list[0][0][0]._environment == {'CFLAGS': '-gsplit-dwarf'}
+
+    # unless the compilers environment is unchanged
+    run.reset_mock()
+    mesonpy.Project(package_pure, tmp_path, meson_args={'setup': ['-Dbuildtype=debug']}, build_profile='dev-fast')
+    args, _ = run.call_args_list[0]
+    assert args[1][1:3] == ['setup', '--reconfigure']
+
@@ -0,0 +1,83 @@
+# SPDX-FileCopyrightText: 2024 The meson-python developers
+#
+# SPDX-License-Identifier: MIT
+
+import subprocess
+import sys
+
+import pytest
+import wheel.wheelfile
+
+import mesonpy._rpath
+
+from .test_wheel import EXT_SUFFIX
+
+
+ORIGIN = {'linux': '$ORIGIN', 'darwin': '@loader_path'}.get(sys.platform)
+
+
+@pytest.fixture
+def extension(wheel_link_against_local_lib, tmp_path):
+    artifact = wheel.wheelfile.WheelFile(wheel_link_against_local_lib)
+    artifact.extractall(tmp_path)
+    return tmp_path / f'example{EXT_SUFFIX}'
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='Linux specific test')
+def test_get_rpath_patchelf(extension):
+    # the in-process reader agrees with patchelf
+    assert mesonpy._rpath._get_rpath(extension) == mesonpy._rpath._patchelf_get_rpath(extension)
+
+
+@pytest.mark.skipif(sys.platform != 'darwin', reason='macOS specific test')
+def test_get_rpath_otool(extension):
+    # the in-process reader agrees with otool
+    assert mesonpy._rpath._get_rpath(extension) == mesonpy._rpath._otool_get_rpath(extension)
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='Linux specific test')
+def test_fix_rpath_in_place(extension, monkeypatch):
+    # a shorter RPATH is written in place without running patchelf
+    def run(*args, **kwargs):
+        raise AssertionError('unexpected subprocess call')
+
+    size = extension.stat().st_size
+    monkeypatch.setattr(subprocess, 'run', run)
+    mesonpy._rpath.fix_rpath(extension, 'libs')
+    assert f'{ORIGIN}/libs' in mesonpy._rpath._get_rpath(extension)
+    assert extension.stat().st_size == size
+
+    # nothing to do: no RPATH entry needs to be modified
+    mesonpy._rpath.fix_rpath(extension, 'libs')
+
+
+@pytest.mark.skipif(sys.platform not in {'linux', 'darwin'}, reason='Not supported on this platform')
+def test_fix_rpath_fallback(extension):
+    # a longer RPATH that does not fit in place
+    path = 'a-very-long-path/' * 8
+    mesonpy._rpath.fix_rpath(extension, path)
+    assert f'{ORIGIN}/{path}' in mesonpy._rpath._get_rpath(extension)
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='Linux specific test')
+def test_rpath_patches(extension):
+    # computing the modifications does not alter the file
+    data = extension.read_bytes()
+    patches = mesonpy._rpath.rpath_patches(extension, 'libs')
+    assert patches
+    assert extension.read_bytes() == data
+    assert mesonpy._rpath.rpath_patches(extension, 'a-very-long-path/' * 8) is None
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='Linux specific test')
+def test_rpath_patches_shared_string(extension, monkeypatch):
+    # the RPATH string is not modified in place when another string
+    # merged by the linker with its tail points inside it
+    [slot], _ = mesonpy._rpath._read_slots(extension)
+    references = mesonpy._rpath._elf_dynstr_references
+
+    def shared(data, order, elfclass, strtab):
+        return [*references(data, order, elfclass, strtab), slot.offset - strtab + 1]
+
+    monkeypatch.setattr(mesonpy._rpath, '_elf_dynstr_references', shared)
+    assert mesonpy._rpath.rpath_patches(extension, 'libs') is None
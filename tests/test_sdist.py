@@ -2,6 +2,7 @@
 #
 # SPDX-License-Identifier: MIT
 
+import gzip
 import os
 import pathlib
 import re
@@ -218,3 +219,47 @@ def test_reproducible(package_pure, tmp_path):
 
     assert sdist_path_a == sdist_path_b
     assert tmp_path.joinpath('a', sdist_path_a).read_bytes() == tmp_path.joinpath('b', sdist_path_b).read_bytes()
+
+
+def test_sdist_jobs(package_pure, tmp_path):
+    # compressing the archive in parallel does not change the result
+    sdist_path_a = mesonpy.build_sdist(tmp_path / 'a')
+    sdist_path_b = mesonpy.build_sdist(tmp_path / 'b', {'sdist-jobs': '4'})
+    assert tmp_path.joinpath('a', sdist_path_a).read_bytes() == tmp_path.joinpath('b', sdist_path_b).read_bytes()
+
+
+def test_sdist_compression_level(package_pure, tmp_path):
+    sdist_path_a = mesonpy.build_sdist(tmp_path / 'a')
+    sdist_path_b = mesonpy.build_sdist(tmp_path / 'b', {'sdist-compression-level': '1'})
+    assert sdist_path_a == sdist_path_b
+    with tarfile.open(tmp_path / 'a' / sdist_path_a, 'r:gz') as a, tarfile.open(tmp_path / 'b' / sdist_path_b, 'r:gz') as b:
+        assert a.getnames() == b.getnames()
+        assert [a.extractfile(x).read() for x in a if x.isfile()] == [b.extractfile(x).read() for x in b if x.isfile()]
+
+
+@pytest.mark.skipif(not mesonpy._util.zstd_available(), reason='Zstandard compression not available')
+def test_sdist_zstd(package_pure, tmp_path):
+    sdist_path = mesonpy.build_sdist(tmp_path, {'sdist-compression': 'zstd', 'sdist-jobs': '2'})
+    assert sdist_path == 'pure-1.0.0.tar.zst'
+    data = tmp_path.joinpath(sdist_path).read_bytes()
+    assert data.startswith(b'\x28\xb5\x2f\xfd')
+
+    # the archive does not depend on the number of threads
+    mesonpy.build_sdist(tmp_path / 'b', {'sdist-compression': 'zstd'})
+    assert tmp_path.joinpath('b', sdist_path).read_bytes() == data
+
+
+def test_gzip_writer(tmp_path):
+    data = os.urandom(100_000) * 5 + b'a' * 1_000_000
+    archives = []
+    for jobs in 1, 3:
+        path = tmp_path / f'{jobs}' / 'archive.gz'
+        path.parent.mkdir()
+        writer = mesonpy._util.GzipWriter(path, jobs)
+        for i in range(0, len(data), 10_000):
+            writer.write(data[i:i + 10_000])
+        assert writer.tell() == len(data)
+        writer.close()
+        assert gzip.decompress(path.read_bytes()) == data
+        archives.append(path.read_bytes())
+    assert archives[0] == archives[1]
@@ -4,7 +4,6 @@
 
 import importlib.machinery
 import os
-import pathlib
 import platform
 import sys
 import sysconfig
@@ -76,7 +75,8 @@ def test_python_host_platform(monkeypatch):
 
 def wheel_builder_test_factory(content, pure=True, limited_api=False):
     manifest = defaultdict(list)
-    manifest.update({key: [(pathlib.Path(x), os.path.join('build', x)) for x in value] for key, value in content.items()})
+    manifest.update({
+        key: [(x, os.path.join('build', x), None) for x in value] for key, value in content.items()})
     return mesonpy._WheelBuilder(None, manifest, limited_api)
 
 
@@ -2,6 +2,8 @@
 #
 # SPDX-License-Identifier: MIT
 
+import json
+import math
 import os
 import re
 import shutil
@@ -10,6 +12,7 @@ import subprocess
 import sys
 import sysconfig
 import textwrap
+import zipfile
 
 import packaging.tags
 import pytest
@@ -175,6 +178,64 @@ def test_rpath(wheel_link_against_local_lib, tmp_path):
     assert rpath >= expected
 
 
+@pytest.mark.skipif(sys.platform not in {'linux', 'darwin'}, reason='Not supported on this platform')
+def test_rpath_build_dir_untouched(package_link_against_local_lib, tmp_path):
+    # relocating the RPATH does not modify the files in the build
+    # directory, thus a subsequent build has nothing to do
+    build_dir = tmp_path / 'build'
+    mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir)})
+    extension = build_dir / f'example{EXT_SUFFIX}'
+    data = extension.read_bytes()
+    mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir)})
+    assert extension.read_bytes() == data
+    output = subprocess.run(['ninja', '-C', os.fspath(build_dir), '-n'], stdout=subprocess.PIPE, text=True).stdout
+    assert 'no work to do' in output
+
+
+@pytest.mark.skipif(sys.platform not in {'linux', 'darwin'}, reason='Not supported on this platform')
+def test_build_dir_shared_interpreters(package_link_against_local_lib, tmp_path, monkeypatch):
+    # building for another interpreter in the same build directory
+    # reconfigures the project but does not relink the bundled library
+    build_dir = tmp_path / 'build'
+    mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir)})
+    library = build_dir / 'lib' / ('libexample.dylib' if sys.platform == 'darwin' else 'libexample.so')
+    mtime = library.stat().st_mtime_ns
+
+    python = tmp_path / 'python'
+    python.symlink_to(sys.executable)
+    monkeypatch.setattr(sys, 'executable', os.fspath(python))
+    mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir)})
+    assert f"python = '{python}'" in build_dir.joinpath('meson-python-native-file.ini').read_text()
+    assert library.stat().st_mtime_ns == mtime
+    output = subprocess.run(['ninja', '-C', os.fspath(build_dir), '-n'], stdout=subprocess.PIPE, text=True).stdout
+    assert 'no work to do' in output
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='Linux specific test')
+def test_strip(package_link_against_local_lib, tmp_path):
+    build_dir = tmp_path / 'build'
+    filename = mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir), 'setup-args': '-Ddebug=true', 'strip': ''})
+    artifact = wheel.wheelfile.WheelFile(tmp_path / filename)
+    artifact.extractall(tmp_path / 'wheel')
+
+    extension = tmp_path / 'wheel' / f'example{EXT_SUFFIX}'
+    build_id, debug, _ = mesonpy._debug._read(extension)
+    assert not debug
+    assert set(mesonpy._rpath._get_rpath(extension)) >= {'$ORIGIN/.link_against_local_lib.mesonpy.libs'}
+
+    # the files in the build directory are untouched
+    assert mesonpy._debug._read(build_dir / f'example{EXT_SUFFIX}')[1]
+
+    with zipfile.ZipFile(build_dir / f'{filename[:-4]}.debug.zip') as archive:
+        names = archive.namelist()
+        # the archive members do not depend on the build directory files
+        assert {(zinfo.date_time, zinfo.external_attr) for zinfo in archive.infolist()} == {
+            (mesonpy._wheelfile.WheelFile.timestamp(), 0o664 << 16)}
+    assert len(names) == 2
+    if build_id is not None:
+        assert f'.build-id/{build_id[:2]}/{build_id[2:]}.debug' in names
+
+
 @pytest.mark.skipif(sys.platform not in {'linux', 'darwin'}, reason='Not supported on this platform')
 def test_uneeded_rpath(wheel_purelib_and_platlib, tmp_path):
     artifact = wheel.wheelfile.WheelFile(wheel_purelib_and_platlib)
@@ -215,6 +276,18 @@ def test_detect_wheel_tag_script(wheel_executable):
     assert name.group('plat') == PLATFORM
 
 
+def test_detect_wheel_tag_script_from_targets(package_executable, tmp_path, mocker):
+    # the executable is classified from the Meson target type
+    # without inspecting the file content
+    mocker.patch('mesonpy._is_native', side_effect=AssertionError)
+    mocker.patch('mesonpy._is_native_header', side_effect=AssertionError)
+    filename = mesonpy.build_wheel(tmp_path)
+    name = wheel.wheelfile.WheelFile(tmp_path / filename).parsed_filename
+    assert name.group('pyver') == 'py3'
+    assert name.group('abi') == 'none'
+    assert name.group('plat') == PLATFORM
+
+
 def test_entrypoints(wheel_full_metadata):
     artifact = wheel.wheelfile.WheelFile(wheel_full_metadata)
 
@@ -356,6 +429,164 @@ def test_encoding(package_encoding, tmp_path):
     }
 
 
+def test_wheel_jobs(package_scipy_like, monkeypatch, tmp_path):
+    # compressing files in parallel does not change the result
+    monkeypatch.setenv('SOURCE_DATE_EPOCH', '1668871912')
+    with mesonpy._project({'build-dir': os.fspath(tmp_path / 'build')}) as project:
+        project.build()
+        manifest = project._manifest
+        serial = mesonpy._WheelBuilder(project._metadata, manifest, project._limited_api)
+        parallel = mesonpy._WheelBuilder(project._metadata, manifest, project._limited_api, jobs=4)
+        a = serial.build(tmp_path / 'a')
+        b = parallel.build(tmp_path / 'b')
+    assert a.read_bytes() == b.read_bytes()
+
+
+def test_wheel_jobs_large_files(package_scipy_like, monkeypatch, tmp_path):
+    # files larger than a chunk are streamed to the archive, not compressed in memory
+    monkeypatch.setenv('SOURCE_DATE_EPOCH', '1668871912')
+    monkeypatch.setattr(mesonpy._wheelfile, 'CHUNK_SIZE', 256)
+    compressfile = mesonpy._wheelfile.WheelFileWriter.compressfile
+
+    def checked_compressfile(self, zinfo, fileobj):
+        assert zinfo.file_size <= 256
+        return compressfile(self, zinfo, fileobj)
+
+    monkeypatch.setattr(mesonpy._wheelfile.WheelFileWriter, 'compressfile', checked_compressfile)
+    with mesonpy._project({'build-dir': os.fspath(tmp_path / 'build')}) as project:
+        project.build()
+        manifest = project._manifest
+        serial = mesonpy._WheelBuilder(project._metadata, manifest, project._limited_api)
+        parallel = mesonpy._WheelBuilder(project._metadata, manifest, project._limited_api, jobs=4)
+        a = serial.build(tmp_path / 'a')
+        b = parallel.build(tmp_path / 'b')
+    assert a.read_bytes() == b.read_bytes()
+
+
+@pytest.mark.parametrize('gil', [True, False])
+def test_wheel_jobs_default(package_pure, mocker, tmp_path, gil):
+    # without the global interpreter lock files are compressed in parallel by default
+    mocker.patch('mesonpy._util.gil_disabled', return_value=not gil)
+    with mesonpy._project({'build-dir': os.fspath(tmp_path / 'build')}) as project:
+        assert project._wheel_jobs == (1 if gil else math.ceil(mesonpy._util.cpu_limit()))
+
+
+def test_wheel_incremental(package_scipy_like, monkeypatch, tmp_path):
+    # rebuilding the wheel using the same build directory copies the
+    # members from the previous wheel and does not change the result
+    monkeypatch.setenv('SOURCE_DATE_EPOCH', '1668871912')
+    settings = {'build-dir': os.fspath(tmp_path / 'build')}
+    filename = mesonpy.build_wheel(tmp_path, settings)
+    data = (tmp_path / filename).read_bytes()
+    monkeypatch.setattr(mesonpy._wheelfile.WheelFileWriter, 'writefile', lambda *args: pytest.fail('file compressed'))
+    assert mesonpy.build_wheel(tmp_path, settings) == filename
+    assert (tmp_path / filename).read_bytes() == data
+    assert sorted(os.listdir(tmp_path)) == sorted(['build', filename])
+
+
+@pytest.mark.parametrize(('level', 'compression'), [('0', zipfile.ZIP_STORED), ('9', zipfile.ZIP_DEFLATED)])
+def test_wheel_compression_level(package_pure, tmp_path, level, compression):
+    filename = mesonpy.build_wheel(tmp_path, {'wheel-compression-level': level})
+    with zipfile.ZipFile(tmp_path / filename) as artifact:
+        for entry in artifact.infolist():
+            assert entry.compress_type == compression
+
+
+def test_timing_report(package_purelib_and_platlib, tmp_path):
+    build_dir = tmp_path / 'build'
+    mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir), 'timing-report': 'trace'})
+
+    report = json.loads(build_dir.joinpath('meson-python-timings.json').read_text())
+    for phase in 'meson setup', 'meson compile', 'manifest', 'wheel', 'file':
+        assert report['totals'][phase]['count'] >= 1
+    files = {event['args']['path']: event['args'] for event in report['events'] if event['name'] == 'file'}
+    assert files['pure.py'] == {'path': 'pure.py', 'reused': False, 'size': os.stat('pure.py').st_size}
+
+    trace = json.loads(build_dir.joinpath('meson-python-timings.trace.json').read_text())
+    assert {event['name'] for event in trace['traceEvents']} == set(report['totals'])
+    assert all(event['ph'] == 'X' for event in trace['traceEvents'])
+
+
+@pytest.mark.skipif(sys.platform not in {'linux', 'darwin'}, reason='Not supported on this platform')
+def test_pgo(package_pgo, tmp_path, capfd, mocker):
+    build_dir = tmp_path / 'build'
+    run = mocker.spy(mesonpy.Project, '_run')
+    filename = mesonpy.build_wheel(tmp_path, {'build-dir': os.fspath(build_dir), 'pgo': ''})
+
+    # the project is built again after being reconfigured to use the profile data
+    commands = [args[1] for args, _ in run.call_args_list]
+    setup = max(i for i, cmd in enumerate(commands) if '-Db_pgo=use' in cmd)
+    build_command = run.call_args_list[0][0][0]._build_command
+    assert build_command in commands[setup + 1:]
+
+    out, err = capfd.readouterr()
+    for stage in 'instrumented build', 'training', 'optimized build':
+        assert f'PGO {stage} took' in out
+    assert any(build_dir.rglob('*.gcda')) or build_dir.joinpath('default.profdata').is_file()
+    assert build_dir.joinpath('meson-python-setup-fingerprint').is_file()
+
+    artifact = wheel.wheelfile.WheelFile(tmp_path / filename)
+    assert wheel_contents(artifact) == {
+        'pgo-1.0.0.dist-info/METADATA',
+        'pgo-1.0.0.dist-info/RECORD',
+        'pgo-1.0.0.dist-info/WHEEL',
+        f'pgo{EXT_SUFFIX}',
+    }
+    # the packed extension module is not instrumented
+    data = artifact.read(f'pgo{EXT_SUFFIX}')
+    assert b'__gcov' not in data
+    assert b'__llvm_profile' not in data
+
+
+def test_strip_build_dir_missing(package_pure):
+    with pytest.raises(mesonpy.ConfigError, match='"strip" setting requires the "build-dir" setting'):
+        with mesonpy._project({'strip': ''}):
+            pass
+
+
+def test_pgo_training_missing(package_pure):
+    with pytest.raises(mesonpy.ConfigError, match='"pgo" setting requires'):
+        with mesonpy._project({'pgo': ''}):
+            pass
+
+
+@pytest.mark.parametrize('jobs', ['1', '2'])
+def test_duplicate_files(package_duplicate_files, tmp_path, monkeypatch, jobs):
+    monkeypatch.setattr(mesonpy, '_DUPLICATE_MIN_SIZE', 1)
+    with pytest.warns(UserWarning, match=r'duplicate_files/copy/data.txt \(same as duplicate_files/data.txt\)'):
+        filename = mesonpy.build_wheel(tmp_path, {'wheel-jobs': jobs})
+    artifact = wheel.wheelfile.WheelFile(tmp_path / filename)
+    assert artifact.read('duplicate_files/data.txt') == artifact.read('duplicate_files/copy/data.txt') == b'duplicate\n'
+    original = artifact.getinfo('duplicate_files/data.txt')
+    duplicate = artifact.getinfo('duplicate_files/copy/data.txt')
+    assert (original.CRC, original.compress_size) == (duplicate.CRC, duplicate.compress_size)
+
+
+@pytest.mark.parametrize('jobs', ['1', '2'])
+def test_duplicate_files_large(package_duplicate_files, tmp_path, monkeypatch, jobs):
+    # files larger than a chunk are streamed to the archive and their
+    # compressed data is copied from the archive for the duplicates
+    monkeypatch.setattr(mesonpy, '_DUPLICATE_MIN_SIZE', 1)
+    monkeypatch.setattr(mesonpy._wheelfile, 'CHUNK_SIZE', 4)
+    writefile = mesonpy._wheelfile.WheelFileWriter.writefile
+    written = []
+
+    def checked_writefile(self, zinfo, fileobj, size):
+        written.append(zinfo.filename)
+        return writefile(self, zinfo, fileobj, size)
+
+    monkeypatch.setattr(mesonpy._wheelfile.WheelFileWriter, 'writefile', checked_writefile)
+    with pytest.warns(UserWarning, match=r'duplicate_files/copy/data.txt \(same as duplicate_files/data.txt\)'):
+        filename = mesonpy.build_wheel(tmp_path, {'wheel-jobs': jobs})
+    assert 'duplicate_files/data.txt' in written
+    assert 'duplicate_files/copy/data.txt' not in written
+    artifact = wheel.wheelfile.WheelFile(tmp_path / filename)
+    assert artifact.read('duplicate_files/data.txt') == artifact.read('duplicate_files/copy/data.txt') == b'duplicate\n'
+    original = artifact.getinfo('duplicate_files/data.txt')
+    duplicate = artifact.getinfo('duplicate_files/copy/data.txt')
+    assert (original.CRC, original.compress_size) == (duplicate.CRC, duplicate.compress_size)
+
+
 def test_custom_target_install_dir(package_custom_target_dir, tmp_path):
     filename = mesonpy.build_wheel(tmp_path)
     artifact = wheel.wheelfile.WheelFile(tmp_path / filename)
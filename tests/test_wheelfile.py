@@ -3,6 +3,7 @@
 # SPDX-License-Identifier: MIT
 
 import contextlib
+import os
 import time
 import zipfile
 
@@ -55,3 +56,191 @@ def test_compression(tmp_path):
     with zipfile.ZipFile(path, 'r') as w:
         for entry in w.infolist():
             assert entry.compress_type == zipfile.ZIP_DEFLATED
+
+
+def test_compression_stored(tmp_path):
+    path = tmp_path / 'test-1.0-py3-any-none.whl'
+    bar = tmp_path / 'bar'
+    bar.write_bytes(b'bar')
+    with mesonpy._wheelfile.WheelFile(path, 'w', compression=zipfile.ZIP_STORED) as w:
+        w.writestr('foo', b'test')
+        w.write(bar, 'bar')
+    with zipfile.ZipFile(path, 'r') as w:
+        for entry in w.infolist():
+            assert entry.compress_type == zipfile.ZIP_STORED
+
+
+def test_compression_level(tmp_path):
+    bar = tmp_path / 'bar'
+    bar.write_bytes(b'bar' * 4096)
+    sizes = []
+    for level in 1, 9:
+        path = tmp_path / str(level) / 'test-1.0-py3-any-none.whl'
+        path.parent.mkdir()
+        with mesonpy._wheelfile.WheelFile(path, 'w', compresslevel=level) as w:
+            w.write(bar, 'bar')
+        with zipfile.ZipFile(path, 'r') as w:
+            sizes.append(w.getinfo('bar').compress_size)
+    assert sizes[0] > sizes[1]
+
+
+def test_compression_methods(tmp_path):
+    # the compression method is selected by file name suffix
+    path = tmp_path / 'test-1.0-py3-any-none.whl'
+    bar = tmp_path / 'bar'
+    bar.write_bytes(b'bar')
+    methods = {'.gz': zipfile.ZIP_STORED, '.png': zipfile.ZIP_STORED, '.tar.gz': zipfile.ZIP_DEFLATED}
+    with mesonpy._wheelfile.WheelFile(path, 'w', methods=methods) as w:
+        w.write(bar, 'bar.py')
+        w.write(bar, 'bar.gz')
+        w.write(bar, 'bar.tar.gz')
+        w.writecompressed(w.compress(bar, 'bar.PNG'))
+    with zipfile.ZipFile(path, 'r') as w:
+        assert w.getinfo('bar.py').compress_type == zipfile.ZIP_DEFLATED
+        assert w.getinfo('bar.gz').compress_type == zipfile.ZIP_STORED
+        assert w.getinfo('bar.tar.gz').compress_type == zipfile.ZIP_DEFLATED
+        assert w.getinfo('bar.PNG').compress_type == zipfile.ZIP_STORED
+        assert w.read('bar.PNG') == b'bar'
+
+    # otherwise the archive compression method applies
+    with mesonpy._wheelfile.WheelFile(path, 'w') as w:
+        w.write(bar, 'bar.png')
+    with zipfile.ZipFile(path, 'r') as w:
+        assert w.getinfo('bar.png').compress_type == zipfile.ZIP_DEFLATED
+
+
+def test_write_chunked(tmp_path, monkeypatch):
+    # files larger than the chunk size are streamed into the archive
+    monkeypatch.setattr(mesonpy._wheelfile, 'CHUNK_SIZE', 7)
+    data = bytes(range(256)) * 33
+    bar = tmp_path / 'bar'
+    bar.write_bytes(data)
+    path = tmp_path / 'test-1.0-py3-any-none.whl'
+    with mesonpy._wheelfile.WheelFile(path, 'w') as w:
+        w.write(bar, 'bar')
+        w.writestr('foo', data)
+    with contextlib.closing(wheel.wheelfile.WheelFile(path, 'r')) as w:
+        assert w.read('bar') == data
+        record = w.read('test-1.0.dist-info/RECORD').decode().splitlines()
+    # RECORD entries match the ones computed on the data all at once
+    bar, foo = (line.split(',', 1)[1] for line in record[:2])
+    assert bar == foo == f'{mesonpy._wheelfile.WheelFile.hash(data)},{len(data)}'
+
+
+def test_write_compressed(tmp_path, monkeypatch):
+    # members compressed ahead of time result in the same archive
+    monkeypatch.setenv('SOURCE_DATE_EPOCH', '1668871912')
+    monkeypatch.setattr(mesonpy._wheelfile, 'CHUNK_SIZE', 1024)
+    bar = tmp_path / 'bar'
+    bar.write_bytes(b'bar' * 4096)
+    a = tmp_path / 'a' / 'test-1.0-py3-any-none.whl'
+    b = tmp_path / 'b' / 'test-1.0-py3-any-none.whl'
+    a.parent.mkdir()
+    b.parent.mkdir()
+    with mesonpy._wheelfile.WheelFile(a, 'w') as w:
+        w.writestr('foo', b'test')
+        w.write(bar, 'bar')
+    with mesonpy._wheelfile.WheelFile(b, 'w') as w:
+        w.writestr('foo', b'test')
+        w.writecompressed(w.compress(bar, 'bar'))
+    assert a.read_bytes() == b.read_bytes()
+
+
+def test_write_copy(tmp_path, monkeypatch):
+    # members copied from the archive being written result in the same
+    # archive, for files smaller and larger than a chunk
+    monkeypatch.setenv('SOURCE_DATE_EPOCH', '1668871912')
+    monkeypatch.setattr(mesonpy._wheelfile, 'CHUNK_SIZE', 7)
+    for size in 5, 4096:
+        bar = tmp_path / f'bar-{size}'
+        bar.write_bytes(os.urandom(size))
+        a = tmp_path / f'a-{size}' / 'test-1.0-py3-any-none.whl'
+        b = tmp_path / f'b-{size}' / 'test-1.0-py3-any-none.whl'
+        a.parent.mkdir()
+        b.parent.mkdir()
+        with mesonpy._wheelfile.WheelFile(a, 'w') as w:
+            w.write(bar, 'bar')
+            w.writestr('foo', b'test')
+            w.write(bar, 'baz')
+        with mesonpy._wheelfile.WheelFile(b, 'w') as w:
+            w.write(bar, 'bar')
+            w.writestr('foo', b'test')
+            w.writecopy(w.fileinfo('baz', os.stat(bar)), 'bar')
+            assert w.digest('baz') == w.digest('bar') == mesonpy._wheelfile.WheelFile.hash(bar.read_bytes())
+        assert a.read_bytes() == b.read_bytes()
+
+
+def test_write_patches(tmp_path, monkeypatch):
+    # patches are applied also when spanning chunks boundaries
+    monkeypatch.setattr(mesonpy._wheelfile, 'CHUNK_SIZE', 4)
+    bar = tmp_path / 'bar'
+    bar.write_bytes(b'0123456789')
+    path = tmp_path / 'test-1.0-py3-any-none.whl'
+    patches = [(0, b'a'), (3, b'bcd'), (9, b'e')]
+    with mesonpy._wheelfile.WheelFile(path, 'w') as w:
+        w.write(bar, 'bar', patches)
+        w.writecompressed(w.compress(bar, 'baz', patches))
+    with zipfile.ZipFile(path, 'r') as w:
+        assert w.read('bar') == w.read('baz') == b'a12bcd678e'
+    assert bar.read_bytes() == b'0123456789'
+
+
+def _add_indexed(w, index, filename, arcname):
+    st = os.stat(filename)
+    member = index.lookup(w.fileinfo(arcname, st), filename, st)
+    if member is None:
+        member = w.compress(filename, arcname)
+    w.writecompressed(member)
+    return member
+
+
+def test_index(tmp_path, monkeypatch):
+    # members added from unmodified files are copied from the previous wheel
+    monkeypatch.setenv('SOURCE_DATE_EPOCH', '1668871912')
+    foo = tmp_path / 'foo'
+    bar = tmp_path / 'bar'
+    foo.write_bytes(b'foo' * 4096)
+    bar.write_bytes(b'bar' * 4096)
+    path = tmp_path / 'test-1.0-py3-any-none.whl'
+    index_file = tmp_path / 'index.json'
+
+    with mesonpy._wheelfile.WheelIndex(index_file, {}) as index:
+        with mesonpy._wheelfile.WheelFile(path, 'w') as w:
+            _add_indexed(w, index, foo, 'foo')
+            _add_indexed(w, index, bar, 'bar')
+        index.save(w, path)
+
+    bar.write_bytes(b'baz' * 8192)
+    path = tmp_path / 'new' / 'test-1.0-py3-any-none.whl'
+    path.parent.mkdir()
+    with mesonpy._wheelfile.WheelIndex(index_file, {}) as index:
+        with mesonpy._wheelfile.WheelFile(path, 'w') as w:
+            st = os.stat(foo)
+            member = index.lookup(w.fileinfo('foo', st), foo, st)
+            assert member is not None
+            w.writecompressed(member)
+            st = os.stat(bar)
+            assert index.lookup(w.fileinfo('bar', st), bar, st) is None
+            w.writecompressed(w.compress(bar, 'bar'))
+
+    with contextlib.closing(wheel.wheelfile.WheelFile(path, 'r')) as w:
+        assert w.read('foo') == b'foo' * 4096
+        assert w.read('bar') == b'baz' * 8192
+
+
+def test_index_key(tmp_path):
+    # the index is discarded when the key does not match
+    foo = tmp_path / 'foo'
+    foo.write_bytes(b'foo')
+    path = tmp_path / 'test-1.0-py3-any-none.whl'
+    index_file = tmp_path / 'index.json'
+    with mesonpy._wheelfile.WheelIndex(index_file, {'libs': None}) as index:
+        with mesonpy._wheelfile.WheelFile(path, 'w') as w:
+            _add_indexed(w, index, foo, 'foo')
+        index.save(w, path)
+    st = os.stat(foo)
+    with mesonpy._wheelfile.WheelFile(tmp_path / 'test-2.0-py3-any-none.whl', 'w') as w:
+        with mesonpy._wheelfile.WheelIndex(index_file, {'libs': None}) as index:
+            assert index.lookup(w.fileinfo('foo', st), foo, st) is not None
+        with mesonpy._wheelfile.WheelIndex(index_file, {'libs': 'lib'}) as index:
+            assert index.lookup(w.fileinfo('foo', st), foo, st) is None